@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+Artifact Cache Module for EVP Pipeline
+
+Content-addressed store of phase outputs. An entry is keyed by a hash of
+everything its phase read: input files by content (bitcode, pass, logger,
+maps, test scripts), parameters by value (thresholds, flags), and the keys
+of the phases it builds on. A phase whose key is in the cache copies the
+stored outputs into place instead of running, so unchanged work is skipped
+and an interrupted batch resumes at the first phase that did not finish.
+
+Layout: <root>/<key[:2]>/<key>/ holds the output files and directories
+under their own names, plus manifest.json (phase, inputs, files). Entries
+are written to a temporary directory and renamed into place, so a killed
+run never leaves a half-stored entry.
+"""
+
+import hashlib
+import json
+import os
+import shutil
+import tempfile
+import time
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+MANIFEST = "manifest.json"
+
+
+def sha256_file(path: Path) -> str:
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(1024 * 1024), b""):
+            h.update(chunk)
+    return h.hexdigest()
+
+
+class InputHasher:
+    """Keys of phase runs by the content of their inputs, without a store"""
+
+    def __init__(self):
+        # path -> (size, mtime_ns, digest); files are hashed once per run
+        self.digests: Dict[str, Tuple[int, int, str]] = {}
+
+    def digest(self, path: Path) -> Optional[str]:
+        """Content hash of a file or directory tree; None if missing"""
+        path = Path(path)
+        if path.is_dir():
+            h = hashlib.sha256()
+            for sub in sorted(p for p in path.rglob("*") if p.is_file()):
+                h.update(f"{sub.relative_to(path)}\0{self.digest(sub)}\0".encode())
+            return h.hexdigest()
+        try:
+            st = path.stat()
+        except OSError:
+            return None
+        cached = self.digests.get(str(path))
+        if cached and cached[:2] == (st.st_size, st.st_mtime_ns):
+            return cached[2]
+        # A <file>.sha256 written after the file (frozen bitcode) is trusted
+        value = None
+        sidecar = Path(f"{path}.sha256")
+        try:
+            if sidecar.stat().st_mtime_ns >= st.st_mtime_ns:
+                value = sidecar.read_text().split()[0]
+        except (OSError, IndexError):
+            pass
+        value = value or sha256_file(path)
+        self.digests[str(path)] = (st.st_size, st.st_mtime_ns, value)
+        return value
+
+    def key(self, phase: str, inputs: Dict) -> str:
+        """
+        Key of a phase run: Path values stand for their content, everything
+        else (strings, numbers, lists, dicts, other keys) for itself.
+        """
+        def canonical(value):
+            if isinstance(value, Path):
+                return {"file": value.name, "sha256": self.digest(value)}
+            if isinstance(value, dict):
+                return {k: canonical(v) for k, v in value.items()}
+            if isinstance(value, (list, tuple)):
+                return [canonical(v) for v in value]
+            return value
+        blob = json.dumps({"phase": phase, "inputs": canonical(inputs)}, sort_keys=True)
+        return hashlib.sha256(blob.encode()).hexdigest()
+
+
+class ArtifactCache(InputHasher):
+    """Content-addressed cache of pipeline phase outputs"""
+
+    def __init__(self, root: Path):
+        super().__init__()
+        self.root = Path(root)
+        self.root.mkdir(parents=True, exist_ok=True)
+
+    # ---- Entries ----------------------------------------------------------
+
+    def entry_dir(self, key: str) -> Path:
+        return self.root / key[:2] / key
+
+    def manifest(self, key: str) -> Optional[Dict]:
+        try:
+            with open(self.entry_dir(key) / MANIFEST) as f:
+                return json.load(f)
+        except (OSError, ValueError):
+            return None
+
+    def fetch(self, key: str, dest_dir: Path) -> bool:
+        """Copy the outputs of entry key into dest_dir; False on a miss"""
+        manifest = self.manifest(key)
+        if manifest is None:
+            return False
+        entry = self.entry_dir(key)
+        dest_dir = Path(dest_dir)
+        for name in manifest["files"]:
+            src, dst = entry / name, dest_dir / name
+            if dst.is_dir() and not dst.is_symlink():
+                shutil.rmtree(dst)
+            elif dst.exists() or dst.is_symlink():
+                dst.unlink()
+            if src.is_dir():
+                shutil.copytree(src, dst, symlinks=True)
+            else:
+                shutil.copy2(src, dst)
+        return True
+
+    def store(self, key: str, phase: str, src_dir: Path, names: List[str],
+              inputs: Optional[Dict] = None) -> bool:
+        """Store src_dir/<name> for every name that exists, as entry key"""
+        src_dir = Path(src_dir)
+        present = [n for n in names if (src_dir / n).exists()]
+        if not present or self.manifest(key) is not None:
+            return False
+        entry = self.entry_dir(key)
+        entry.parent.mkdir(parents=True, exist_ok=True)
+        tmp = Path(tempfile.mkdtemp(prefix=f".{key[:12]}.", dir=entry.parent))
+        try:
+            for name in present:
+                if (src_dir / name).is_dir():
+                    shutil.copytree(src_dir / name, tmp / name, symlinks=True)
+                else:
+                    shutil.copy2(src_dir / name, tmp / name)
+            with open(tmp / MANIFEST, "w") as f:
+                json.dump({"phase": phase, "files": present, "inputs": inputs or {},
+                           "created": time.time()}, f, indent=2, default=str)
+            os.rename(tmp, entry)
+        except OSError:
+            # Lost a race against a concurrent store of the same key
+            shutil.rmtree(tmp, ignore_errors=True)
+            return False
+        return True
@@ -0,0 +1,36 @@
+// Persistent APR driver: every whitespace-separated token of a corpus file
+// goes through the string and hash operations of apr_driver.c, in a pool
+// destroyed after the input.
+
+#include <apr.h>
+#include <apr_pools.h>
+#include <apr_strings.h>
+#include <apr_hash.h>
+#include "persistent_driver.h"
+
+static apr_pool_t *root, *pool;
+
+static int vase_target_init(void) {
+    if (apr_initialize() != APR_SUCCESS)
+        return 1;
+    atexit(apr_terminate);
+    return apr_pool_create(&root, NULL) != APR_SUCCESS;
+}
+
+static void vase_target_run(const uint8_t *data, size_t size) {
+    if (apr_pool_create(&pool, root) != APR_SUCCESS)
+        return;
+    char *text = apr_pstrmemdup(pool, (const char *)data, size);
+    apr_hash_t *ht = apr_hash_make(pool);
+    char *last;
+    for (char *tok = apr_strtok(text, " \t\r\n", &last); tok;
+         tok = apr_strtok(NULL, " \t\r\n", &last)) {
+        char *result = apr_psprintf(pool, "Test %s", tok);
+        apr_hash_set(ht, tok, APR_HASH_KEY_STRING, result);
+    }
+}
+
+static void vase_target_reset(void) {
+    apr_pool_destroy(pool);
+    pool = NULL;
+}
@@ -0,0 +1,3 @@
+CREATE TABLE test (id INT, value TEXT);
+INSERT INTO test VALUES (1, 'value_1');
+SELECT * FROM test WHERE id < 10;
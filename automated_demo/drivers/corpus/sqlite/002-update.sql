@@ -0,0 +1,4 @@
+CREATE TABLE t (a INTEGER PRIMARY KEY, b TEXT UNIQUE);
+INSERT INTO t(b) VALUES ('x'), ('yy');
+UPDATE t SET b = upper(b) WHERE a = 2;
+SELECT a, length(b) FROM t ORDER BY b DESC;
@@ -0,0 +1,5 @@
+CREATE TABLE t (k TEXT, v REAL);
+CREATE INDEX tk ON t(k);
+INSERT INTO t VALUES ('a', 1.5), ('b', -2), ('a', NULL);
+SELECT k, sum(v), count(*) FROM t GROUP BY k HAVING count(*) > 1;
+DELETE FROM t WHERE v IS NULL;
@@ -0,0 +1,129 @@
+// Persistent-mode profiling driver for library targets.
+//
+// Replays every file of the given corpus directories (recursively, in name
+// order) through the instrumented library in one process, so profiling is
+// not bounded by exec and logger start-up. Records go to the logger's
+// aggregating mode (VASE_AGGREGATE=1, set unless already in the environment).
+//
+// A target includes this header and defines:
+//   vase_target_init()   once per process; nonzero = failure
+//   vase_target_run()    once per input; data is NUL-terminated
+//   vase_target_reset()  after every input, to drop per-input state
+//
+//   <target>_driver [-f] CORPUS_DIR|FILE...
+//
+// -f runs each input in a child forked from the initialized process instead
+// (fork server), for targets whose state cannot be reset; the child exits
+// after one input, so vase_target_reset() is not called. A child that crashes
+// or runs past VASE_DRIVER_TIMEOUT seconds (default 10) loses its records.
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int vase_target_init(void);
+static void vase_target_run(const uint8_t *data, size_t size);
+static void vase_target_reset(void);
+
+static unsigned long vase_inputs, vase_failed;
+static int vase_fork_server;
+
+static uint8_t *vase_read_input(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    uint8_t *data = NULL;
+    struct stat st;
+    if (fstat(fileno(f), &st) == 0 && (data = malloc((size_t)st.st_size + 1)) != NULL) {
+        *size = fread(data, 1, (size_t)st.st_size, f);
+        data[*size] = '\0';
+    }
+    fclose(f);
+    return data;
+}
+
+static void vase_run_input(const char *path) {
+    size_t size = 0;
+    uint8_t *data = vase_read_input(path, &size);
+    if (!data) {
+        vase_failed++;
+        return;
+    }
+    vase_inputs++;
+    if (!vase_fork_server) {
+        vase_target_run(data, size);
+        vase_target_reset();
+    } else {
+        pid_t pid = fork();
+        if (pid == 0) {
+            const char *t = getenv("VASE_DRIVER_TIMEOUT");
+            alarm(t && *t ? (unsigned)atoi(t) : 10);
+            vase_target_run(data, size);
+            exit(0);   // runs the logger's atexit flush
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            vase_failed++;
+    }
+    free(data);
+}
+
+static void vase_run_path(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        vase_run_input(path);
+        return;
+    }
+    struct dirent **names;
+    int n = scandir(path, &names, NULL, alphasort);
+    if (n < 0) {
+        perror(path);
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        if (names[i]->d_name[0] != '.') {
+            size_t len = strlen(path) + strlen(names[i]->d_name) + 2;
+            char *child = malloc(len);
+            if (child) {
+                snprintf(child, len, "%s/%s", path, names[i]->d_name);
+                vase_run_path(child);
+                free(child);
+            }
+        }
+        free(names[i]);
+    }
+    free(names);
+}
+
+int main(int argc, char **argv) {
+    int i = 1;
+    if (i < argc && strcmp(argv[i], "-f") == 0) {
+        vase_fork_server = 1;
+        i++;
+    }
+    if (i >= argc) {
+        fprintf(stderr, "usage: %s [-f] CORPUS_DIR|FILE...\n", argv[0]);
+        return 2;
+    }
+    setenv("VASE_AGGREGATE", "1", 0);
+    if (vase_target_init() != 0) {
+        fprintf(stderr, "%s: target initialization failed\n", argv[0]);
+        return 1;
+    }
+    for (; i < argc; ++i)
+        vase_run_path(argv[i]);
+    fprintf(stderr, "%s: %lu inputs, %lu failed\n", argv[0], vase_inputs, vase_failed);
+    return 0;
+}
@@ -0,0 +1,23 @@
+// Persistent sqlite driver: every corpus file is an SQL script, run against
+// a fresh in-memory database.
+
+#include <sqlite3.h>
+#include "persistent_driver.h"
+
+static sqlite3 *db;
+
+static int vase_target_init(void) {
+    return sqlite3_initialize() != SQLITE_OK;
+}
+
+static void vase_target_run(const uint8_t *data, size_t size) {
+    (void)size;
+    if (sqlite3_open(":memory:", &db) != SQLITE_OK)
+        return;
+    sqlite3_exec(db, (const char *)data, 0, 0, 0);
+}
+
+static void vase_target_reset(void) {
+    sqlite3_close(db);
+    db = NULL;
+}
@@ -1,11 +1,15 @@
 #!/usr/bin/env python3
 import json
 import os
+import shutil
 import subprocess
 import sys
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 from datetime import datetime
+from artifact_cache import ArtifactCache, InputHasher
 from klee_runner import KLEERunner
+from klee_scheduler import KLEEScheduler
 
 class EVPPipeline:
     def __init__(self, config_file="config/programs.json"):
@@ -30,8 +34,78 @@ class EVPPipeline:
         self.artifacts_dir = Path(__file__).parent / "benchmarks" / "evp_artifacts"
         self.artifacts_dir.mkdir(parents=True, exist_ok=True)
         
+        # VASE_INCREMENTAL=1: re-instrument and re-profile only functions whose
+        # structural hash changed since the last run (see _instrument_cmd).
+        self.incremental = os.environ.get("VASE_INCREMENTAL", "0") == "1"
+        
+        # VASE_HOT_TOP_K=N: instrument only the N sites a short vanilla KLEE
+        # run spent the most solver time on (see _hot_site_args).
+        self.hot_top_k = int(os.environ.get("VASE_HOT_TOP_K", "0"))
+        
+        # VASE_MAP_STATE=1: fold each phase-2 log into mapState.bin with
+        # vase-mapgen --state and empty it, instead of regenerating the map
+        # from an ever-growing log (see phase2_profile).
+        self.map_state = os.environ.get("VASE_MAP_STATE", "0") == "1"
+        
+        # VASE_LIB_MAP=1: profile every program of a category first, then pool
+        # their library (gnulib lib/) sites into one map that phase 3 layers
+        # under each program's own (see build_lib_map).
+        self.lib_map = os.environ.get("VASE_LIB_MAP", "0") == "1"
+        
+        # VASE_PRUNE=1: after phase 3, drop or demote map sites whose rewrites
+        # cost more solver time than they saved, for this and later runs (see
+        # tools/analyzer/prune_map.py).
+        self.prune = os.environ.get("VASE_PRUNE", "0") == "1"
+        
+        # VASE_FUZZ=1: after the tests, add coverage-guided inputs until no new
+        # sites appear or VASE_FUZZ_TIME seconds pass (see fuzz_profile).
+        self.fuzz = os.environ.get("VASE_FUZZ", "0") == "1"
+        self.fuzz_time = int(os.environ.get("VASE_FUZZ_TIME", "300"))
+        
+        # VASE_MIN_TESTS=1: once, record each generic-harness test's log and
+        # keep the smallest test subset giving the same map (testSubset.txt);
+        # later runs execute only those tests (see minimize_tests).
+        self.min_tests = os.environ.get("VASE_MIN_TESTS", "0") == "1"
+        
+        # VASE_KLEE_SCHEDULER=1: queue the phase-3 runs of all programs and let
+        # klee_scheduler.py pack them onto the cores and RAM (budget in MB:
+        # VASE_KLEE_MEMORY_MB, default 90% of RAM); the queue survives restarts.
+        self.klee_scheduler = os.environ.get("VASE_KLEE_SCHEDULER", "0") == "1"
+        self.klee_memory_mb = int(os.environ.get("VASE_KLEE_MEMORY_MB", "0")) or None
+        
+        # VASE_PLATEAU=SECONDS: stop each KLEE arm once it has gone that long
+        # without new coverage or tests, instead of running out --max-time
+        # (klee_stats.PlateauRule; the same rule for vanilla and EVP).
+        self.plateau_seconds = float(os.environ.get("VASE_PLATEAU", "0"))
+        
+        # VASE_CACHE=1: key the outputs of every phase by a hash of its inputs
+        # and parameters and reuse them while those are unchanged (see
+        # artifact_cache.py); entries live in VASE_CACHE_DIR.
+        self.cache = None
+        if os.environ.get("VASE_CACHE", "0") == "1":
+            self.cache = ArtifactCache(Path(os.environ.get(
+                "VASE_CACHE_DIR", str(self.artifacts_dir / "cache"))))
+        self.cache_keys = {}  # (category, program, phase) -> key of this run
+        
+        # Phase 2 parallelism: VASE_PROFILE_JOBS programs at once, each running
+        # VASE_TEST_JOBS test scripts at once (default: split the cores).
+        self.profile_jobs = max(1, int(os.environ.get("VASE_PROFILE_JOBS", "1")))
+        self.test_jobs = int(os.environ.get("VASE_TEST_JOBS", "0")) or \
+            max(1, (os.cpu_count() or 1) // self.profile_jobs)
+        if self.lib_map and self.map_state:
+            # The library map is built from the raw logs, which --state empties
+            print("[WARNING] VASE_LIB_MAP needs the full value logs; ignoring VASE_MAP_STATE")
+            self.map_state = False
+        if self.cache and (self.incremental or self.map_state):
+            # Both carry state from run to run that the cache keys cannot see
+            print("[WARNING] VASE_INCREMENTAL and VASE_MAP_STATE reuse earlier runs themselves; ignoring VASE_CACHE")
+            self.cache = None
+        # Phase-3 keys also name scheduler runs, so they are computed either way
+        self.hasher = self.cache or InputHasher()
+        
         # Initialize KLEE runner
         self.klee_runner = KLEERunner(self.env["KLEE_BIN"], project_root, self.config)
+        self.klee_runner.plateau_seconds = self.plateau_seconds
         
     def run_command(self, cmd, cwd=None):
         """Execute command and return output"""
@@ -72,8 +146,11 @@ class EVPPipeline:
         
         # Instrument
         inst_bc = prog_dir / f"{program}.evpinstr.bc"
-        cmd = f'{self.env["OPT"]} -load {self.env["PASS_SO"]} -vase-instrument {base_bc} -o {inst_bc}'
-        self.run_command(cmd)
+        libs = cfg.get("libs", "")
+        key = self._phase1_key(category, program, base_bc, prog_dir, libs)
+        if self._cache_fetch(key, "Phase 1", prog_dir, program):
+            return prog_dir
+        self.run_command(self._instrument_cmd(base_bc, inst_bc, prog_dir))
         
         # Link with logger
         logger_bc = prog_dir / "logger.bc"
@@ -86,13 +163,122 @@ class EVPPipeline:
         
         # Build executable
         final_exe = prog_dir / f"{program}_final_exe"
-        libs = cfg.get("libs", "")
         cmd = f'{self.env["CLANG"]} {final_bc} -o {final_exe} {libs}'
         self.run_command(cmd)
         
+        if final_exe.exists():
+            self._cache_store(key, "Phase 1", prog_dir, self._phase1_outputs(program))
         print(f"[OK] Instrumented {program} -> {final_exe}")
         return prog_dir
     
+    def _phase1_outputs(self, program):
+        return [f"{program}.evpinstr.bc", "logger.bc", f"{program}_final.bc",
+                f"{program}_final_exe", "staticValueMap.json", "siteManifest.json"]
+    
+    def _phase1_key(self, category, program, base_bc, prog_dir, libs):
+        """
+        Cache key of phase 1: base bitcode, pass, logger, tools and pass
+        options. Built from the inputs alone: the opt command is only needed
+        on a miss, and making it may profile hot sites or rotate files.
+        """
+        if not self.cache:
+            return None
+        stats = prog_dir / "siteStats.json"
+        key = self.cache.key("phase1", {
+            "base_bc": Path(base_bc),
+            "pass": Path(self.env["PASS_SO"]),
+            "logger": Path(self.env["LOGGER_C"]),
+            "tools": [self.env["CLANG"], self.env["OPT"], self.env["LLVMLINK"]],
+            "options": self._instrument_options(),
+            "hot_sites": stats if self.hot_top_k > 0 and stats.exists() else None,
+            "libs": libs
+        })
+        self.cache_keys[(category, program, 1)] = key
+        return key
+    
+    def _cache_fetch(self, key, phase, dest_dir, program):
+        """Restore the outputs stored under key into dest_dir, if any"""
+        if not key or not self.cache.fetch(key, dest_dir):
+            return False
+        print(f"[CACHE] {phase} inputs of {program} unchanged, reusing {key[:12]}")
+        return True
+    
+    def _cache_store(self, key, phase, src_dir, names):
+        if key and self.cache.store(key, phase, src_dir, names):
+            print(f"[CACHE] Stored {phase} outputs as {key[:12]}")
+    
+    def _instrument_cmd(self, base_bc, out_bc, prog_dir):
+        """opt command line for the VASE pass.
+
+        Operands with a statically provable value set go to staticValueMap.json
+        instead of being logged, and every function's hash and site ids go to
+        siteManifest.json; phase 2 merges both back into the map. In incremental
+        mode the previous manifest, map and log are kept as *.prev.* and only
+        functions that changed since then are instrumented.
+        """
+        static_map = prog_dir / "staticValueMap.json"
+        manifest = prog_dir / "siteManifest.json"
+        options = self._instrument_options()
+        cmd = (f'{self.env["OPT"]} -load {self.env["PASS_SO"]} -vase-instrument '
+               f'-vase-static-map={static_map} -vase-site-manifest={manifest}')
+        if options["libc_calls"]:
+            cmd += f" '-vase-libc-calls={options['libc_calls']}'"
+        if options["input_offsets"]:
+            cmd += " -vase-input-offsets"
+        cmd += self._hot_site_args(base_bc, prog_dir, cmd)
+        
+        old_map = prog_dir / "limitedValuedMap.json"
+        if self.incremental and manifest.exists() and old_map.exists():
+            prev_manifest = prog_dir / "siteManifest.prev.json"
+            manifest.replace(prev_manifest)
+            old_map.replace(prog_dir / "limitedValuedMap.prev.json")
+            vase_log = prog_dir / "vase_value_log.txt"
+            if vase_log.exists():
+                vase_log.replace(prog_dir / "vase_value_log.prev.txt")
+            cmd += f' -vase-changed-since={prev_manifest}'
+            print(f"[INFO] Incremental: instrumenting functions changed since {prev_manifest}")
+        
+        return f'{cmd} {base_bc} -o {out_bc}'
+    
+    def _instrument_options(self):
+        """Pass settings taken from the environment (see _instrument_cmd)"""
+        return {
+            # e.g. VASE_LIBC_CALLS=default, or read,stat:1@24:4=st_mode
+            "libc_calls": os.environ.get("VASE_LIBC_CALLS", ""),
+            "input_offsets": os.environ.get("VASE_INPUT_OFFSETS", "0") == "1",
+            "hot_top_k": self.hot_top_k,
+            "hot_profile_time": os.environ.get("VASE_HOT_PROFILE_TIME", "120s")
+        }
+    
+    def _hot_site_args(self, base_bc, prog_dir, instrument_cmd):
+        """-vase-hot-sites options when VASE_HOT_TOP_K is set.
+
+        siteStats.json comes from a short vanilla KLEE run (VASE_HOT_PROFILE_TIME,
+        default 120s) on bitcode instrumented at every site and linked with the
+        logger, so queries carry the site ids the filter selects by; base
+        bitcode would put every query under loc:0. It is reused until deleted.
+        """
+        if self.hot_top_k <= 0:
+            return ""
+        stats = prog_dir / "siteStats.json"
+        if not stats.exists():
+            program, category = prog_dir.name, prog_dir.parent.name
+            print(f"[INFO] Profiling solver time per site for {program}...")
+            profile_instr = prog_dir / f"{program}.profile.evpinstr.bc"
+            profile_bc = prog_dir / f"{program}.profile.bc"
+            logger_bc = prog_dir / "logger.bc"
+            ok = (self.run_command(f'{instrument_cmd} {base_bc} -o {profile_instr}').returncode == 0 and
+                  self.run_command(f'{self.env["CLANG"]} -O0 -emit-llvm -c {self.env["LOGGER_C"]} '
+                                   f'-o {logger_bc}').returncode == 0 and
+                  self.run_command(f'{self.env["LLVMLINK"]} {profile_instr} {logger_bc} '
+                                   f'-o {profile_bc}').returncode == 0)
+            if not ok or not self.klee_runner.profile_sites(
+                    profile_bc, stats, program, category,
+                    max_time=os.environ.get("VASE_HOT_PROFILE_TIME", "120s")):
+                print("[WARNING] Instrumenting every site")
+                return ""
+        return f" -vase-hot-sites={stats} -vase-hot-top-k={self.hot_top_k}"
+    
     def _phase1_coreutils(self, program, prog_dir):
         """Phase 1 implementation for coreutils utilities"""
         print(f"[PHASE 1] Processing coreutils utility: {program}")
@@ -144,43 +330,46 @@ class EVPPipeline:
             
             print(f"[OK] Bitcode extracted: {base_bc}")
         
-        # Step 2: Instrument bitcode
-        print(f"[STEP 2] Instrumenting bitcode with VASE pass...")
-        instr_bc = prog_dir / f"{program}.evpinstr.bc"
-        cmd = f'{self.env["OPT"]} -load {self.env["PASS_SO"]} -vase-instrument {base_bc} -o {instr_bc}'
-        result = self.run_command(cmd)
-        if result.returncode != 0:
-            raise RuntimeError(f"Bitcode instrumentation failed: {result.stderr}")
-        print(f"[OK] Bitcode instrumented: {instr_bc}")
-        
-        # Step 3: Build logger
-        print(f"[STEP 3] Building logger runtime...")
-        logger_bc = prog_dir / "logger.bc"
-        cmd = f'{self.env["CLANG"]} -O0 -emit-llvm -c {self.env["LOGGER_C"]} -o {logger_bc}'
-        result = self.run_command(cmd)
-        if result.returncode != 0:
-            raise RuntimeError(f"Logger build failed: {result.stderr}")
-        print(f"[OK] Logger built: {logger_bc}")
-        
-        # Step 4: Link instrumented bitcode with logger
-        print(f"[STEP 4] Linking instrumented bitcode with logger...")
-        final_bc = prog_dir / f"{program}_final.bc"
-        cmd = f'{self.env["LLVMLINK"]} {instr_bc} {logger_bc} -o {final_bc}'
-        result = self.run_command(cmd)
-        if result.returncode != 0:
-            raise RuntimeError(f"Bitcode linking failed: {result.stderr}")
-        print(f"[OK] Final bitcode linked: {final_bc}")
-        
-        # Step 5: Build final executable
-        print(f"[STEP 5] Building final executable...")
-        final_exe = prog_dir / f"{program}_final_exe"
+        # Steps 2-5 are skipped while their inputs are unchanged
         # Use coreutils-specific libraries including ACL support
         libs = "-ldl -lpthread -lselinux -lcap -lacl -lattr"
-        cmd = f'{self.env["CLANG"]} {final_bc} -o {final_exe} {libs}'
-        result = self.run_command(cmd)
-        if result.returncode != 0:
-            raise RuntimeError(f"Executable build failed: {result.stderr}")
-        print(f"[OK] Final executable built: {final_exe}")
+        key = self._phase1_key("coreutils", program, base_bc, prog_dir, libs)
+        final_exe = prog_dir / f"{program}_final_exe"
+        if not self._cache_fetch(key, "Phase 1", prog_dir, program):
+            # Step 2: Instrument bitcode
+            print(f"[STEP 2] Instrumenting bitcode with VASE pass...")
+            instr_bc = prog_dir / f"{program}.evpinstr.bc"
+            result = self.run_command(self._instrument_cmd(base_bc, instr_bc, prog_dir))
+            if result.returncode != 0:
+                raise RuntimeError(f"Bitcode instrumentation failed: {result.stderr}")
+            print(f"[OK] Bitcode instrumented: {instr_bc}")
+            
+            # Step 3: Build logger
+            print(f"[STEP 3] Building logger runtime...")
+            logger_bc = prog_dir / "logger.bc"
+            cmd = f'{self.env["CLANG"]} -O0 -emit-llvm -c {self.env["LOGGER_C"]} -o {logger_bc}'
+            result = self.run_command(cmd)
+            if result.returncode != 0:
+                raise RuntimeError(f"Logger build failed: {result.stderr}")
+            print(f"[OK] Logger built: {logger_bc}")
+            
+            # Step 4: Link instrumented bitcode with logger
+            print(f"[STEP 4] Linking instrumented bitcode with logger...")
+            final_bc = prog_dir / f"{program}_final.bc"
+            cmd = f'{self.env["LLVMLINK"]} {instr_bc} {logger_bc} -o {final_bc}'
+            result = self.run_command(cmd)
+            if result.returncode != 0:
+                raise RuntimeError(f"Bitcode linking failed: {result.stderr}")
+            print(f"[OK] Final bitcode linked: {final_bc}")
+            
+            # Step 5: Build final executable
+            print(f"[STEP 5] Building final executable...")
+            cmd = f'{self.env["CLANG"]} {final_bc} -o {final_exe} {libs}'
+            result = self.run_command(cmd)
+            if result.returncode != 0:
+                raise RuntimeError(f"Executable build failed: {result.stderr}")
+            print(f"[OK] Final executable built: {final_exe}")
+            self._cache_store(key, "Phase 1", prog_dir, self._phase1_outputs(program))
         
         # Step 6: Stage executable for testing
         staged_exe = inst_dir / f"{program}_final_exe"
@@ -244,28 +433,54 @@ class EVPPipeline:
         
         cfg = self.config[category]
         vase_log = prog_dir / "vase_value_log.txt"
+        map_file = prog_dir / "limitedValuedMap.json"
+        
+        key = self._phase2_key(category, program, prog_dir)
+        if self._cache_fetch(key, "Phase 2", prog_dir, program):
+            return map_file
+        if key and vase_log.exists():
+            # A cached log is a function of the inputs alone, not of earlier runs
+            vase_log.unlink()
         
         # Set environment for logging
         env = os.environ.copy()
         env["VASE_LOG"] = str(vase_log)
         env["VASE_DIR"] = str(prog_dir)
+        env["VASE_TEST_JOBS"] = str(self.test_jobs)
+        shard_dir = prog_dir / "log-shards"
         
         # Run tests based on type
         if category == "coreutils":
             # Check if official unit tests exist for this utility
             tests_dir = Path(__file__).parent / "benchmarks" / "coreutils" / "coreutils-8.31" / "tests"
             utility_test_dir = tests_dir / program
+            # Each script is a test of its own, so make can run them side by side
+            official_tests = sorted(
+                f"{program}/{p.name}" for p in utility_test_dir.iterdir()
+                if p.suffix in (".sh", ".pl", ".xpl")) if utility_test_dir.is_dir() else []
             
-            if utility_test_dir.exists() and utility_test_dir.is_dir():
+            if official_tests:
                 print(f"[INFO] Using official unit tests for {program}")
                 # Set PATH to prioritize instrumented binary
                 instrumented_bin_dir = str(prog_dir)
                 env["PATH"] = f"{instrumented_bin_dir}:{env.get('PATH', '')}"
                 
-                # Run official unit tests from the main tests directory
+                # In parallel, every instrumented process logs to its own
+                # shard (logger.c VASE_LOG_SHARD_DIR), merged below
+                if self.test_jobs > 1:
+                    shard_dir.mkdir(exist_ok=True)
+                    env["VASE_LOG_SHARD_DIR"] = str(shard_dir)
+                
+                # Run official unit tests from the main tests directory,
+                # VASE_TEST_JOBS scripts at once. Programs profiled in parallel
+                # share the directory: check-TESTS skips the rebuild of `all`
+                # they would race on, and each keeps its own summary log (the
+                # per-script logs sit next to the scripts, apart already).
                 try:
                     result = subprocess.run(
-                        ["make", "check", f"TESTS={program}"], 
+                        ["make", f"-j{self.test_jobs}", "check-TESTS",
+                         "TESTS=" + " ".join(official_tests),
+                         f"TEST_SUITE_LOG={prog_dir / 'test-suite.log'}"],
                         env=env, 
                         cwd=tests_dir,
                         capture_output=True, 
@@ -284,17 +499,37 @@ class EVPPipeline:
                 print(f"[INFO] No official tests found for {program}, using generic harness")
                 # Fall back to generic test harness
                 test_harness = Path(__file__).parent / "test-harness-generic.sh"
+                test_subset = prog_dir / "testSubset.txt"
+                test_logs = prog_dir / "testLogs"
+                if self.min_tests and test_subset.exists():
+                    print(f"[INFO] Running the minimized test subset {test_subset}")
+                    env["VASE_TEST_SUBSET"] = str(test_subset)
+                elif self.min_tests:
+                    env["VASE_TEST_LOGS"] = str(test_logs)
                 cmd = f"bash {test_harness} {program}"
                 subprocess.run(cmd, shell=True, env=env, cwd=Path(__file__).parent)
+                if self.min_tests and test_logs.is_dir():
+                    self.minimize_tests(category, test_logs, test_subset)
         elif cfg["type"] == "library":
-            # Run driver program
+            # Run driver program; a persistent driver (drivers/persistent_driver.h)
+            # replays the whole corpus in one process
             driver_exe = prog_dir / f"{program}_driver"
-            subprocess.run(str(driver_exe), env=env)
+            cmd = [str(driver_exe)]
+            if cfg.get("corpus"):
+                if cfg.get("fork_server"):
+                    cmd.append("-f")
+                cmd.append(str(Path(__file__).parent / cfg["corpus"]))
+            subprocess.run(cmd, env=env)
         else:
             # Run program's test suite
             test_cmd = cfg["test_cmd"].format(program=program)
             subprocess.run(test_cmd, shell=True, env=env)
         
+        if shard_dir.is_dir():
+            self.merge_log_shards(shard_dir, vase_log)
+        if self.fuzz and category == "coreutils":
+            self.fuzz_profile(program, prog_dir, vase_log)
+        
         # Validate value log collection
         self.validate_value_log(vase_log, program)
         
@@ -303,19 +538,112 @@ class EVPPipeline:
         
         # Generate map
         thresholds = cfg["thresholds"]
-        map_file = prog_dir / "limitedValuedMap.json"
-        # Use generate_limited_map.py from automated_demo directory
-        generate_script = Path(__file__).parent / "generate_limited_map.py"
-        cmd = f"""python3 {generate_script} \
+        # vase-mapgen (tools/mapgen/build.sh) writes the same map much faster
+        # on large logs; the Python analyzer is the reference fallback.
+        mapgen = Path(__file__).parent / "tools" / "mapgen" / "vase-mapgen"
+        generate_script = Path(__file__).parent / "tools" / "analyzer" / "generate_limited_map.py"
+        generator = str(mapgen) if os.access(mapgen, os.X_OK) else f"python3 {generate_script}"
+        cmd = f"""{generator} \
                   --log {vase_log} \
                   --out {map_file} \
                   --max-values {thresholds['max_values']} \
                   --min-occurrence {thresholds['min_occurrence']}"""
+        static_map = prog_dir / "staticValueMap.json"
+        if static_map.exists():
+            cmd += f" --static-map {static_map}"
+        if self.map_state:
+            if os.access(mapgen, os.X_OK):
+                cmd += f" --state {prog_dir / 'mapState.bin'} --truncate-log"
+            else:
+                print("[WARNING] VASE_MAP_STATE needs tools/mapgen/vase-mapgen; "
+                      "regenerating the map from the full log")
+        
+        # Incremental run: keep the old entries of functions that did not change
+        prev_manifest = prog_dir / "siteManifest.prev.json"
+        prev_map = prog_dir / "limitedValuedMap.prev.json"
+        if self.incremental and prev_manifest.exists() and prev_map.exists():
+            carried_map = prog_dir / "carriedMap.json"
+            diff_script = Path(__file__).parent / "tools" / "analyzer" / "diff_site_manifest.py"
+            self.run_command(f"python3 {diff_script} --old {prev_manifest} "
+                             f"--new {prog_dir / 'siteManifest.json'} "
+                             f"--old-map {prev_map} --out-map {carried_map}")
+            if carried_map.exists():
+                cmd += f" --carry-map {carried_map}"
         self.run_command(cmd)
         
+        # Sites found unprofitable by earlier phase-3 runs stay pruned
+        decisions = prog_dir / "prunedSites.json"
+        if self.prune and decisions.exists():
+            prune_script = Path(__file__).parent / "tools" / "analyzer" / "prune_map.py"
+            self.run_command(f"python3 {prune_script} --map {map_file} --decisions {decisions}")
+        
+        if map_file.exists():
+            self._cache_store(key, "Phase 2", prog_dir, self._phase2_outputs())
         print(f"[OK] Generated map -> {map_file}")
         return map_file
     
+    def _phase2_outputs(self):
+        return ["vase_value_log.txt", "limitedValuedMap.json", "testSubset.txt", "fuzzCorpus"]
+    
+    def _phase2_key(self, category, program, prog_dir):
+        """Cache key of phase 2: the phase-1 outputs, tests, generator and thresholds"""
+        phase1 = self.cache_keys.get((category, program, 1))
+        if not self.cache or not phase1:
+            return None
+        here = Path(__file__).parent
+        cfg = {k: v for k, v in self.config[category].items() if k != "programs"}
+        mapgen = here / "tools" / "mapgen" / "vase-mapgen"
+        key = self.cache.key("phase2", {
+            "phase1": phase1,
+            "config": cfg,
+            "tests": here / "benchmarks" / "coreutils" / "coreutils-8.31" / "tests" / program
+                     if category == "coreutils" else None,
+            "harness": here / "test-harness-generic.sh",
+            "corpus": here / cfg["corpus"] if cfg.get("corpus") else None,
+            "generator": mapgen if os.access(mapgen, os.X_OK)
+                         else here / "tools" / "analyzer" / "generate_limited_map.py",
+            "logger_env": {k: os.environ.get(k) for k in ("VASE_AGGREGATE", "VASE_CTX_DEPTH")},
+            "min_tests": self.min_tests,
+            "test_subset": prog_dir / "testSubset.txt" if self.min_tests else None,
+            "fuzz": [self.fuzz_time, prog_dir / "fuzzCorpus"] if self.fuzz else None,
+            "pruned": prog_dir / "prunedSites.json" if self.prune else None
+        })
+        self.cache_keys[(category, program, 2)] = key
+        return key
+    
+    def minimize_tests(self, category, test_logs, test_subset):
+        """Keep the tests needed for the same map, from per-test logs"""
+        thresholds = self.config[category]["thresholds"]
+        script = Path(__file__).parent / "tools" / "analyzer" / "minimize_tests.py"
+        result = self.run_command(f"python3 {script} --test-logs {test_logs} --out {test_subset} "
+                                  f"--max-values {thresholds['max_values']} "
+                                  f"--min-occurrence {thresholds['min_occurrence']}")
+        print(result.stdout, end="")
+        shutil.rmtree(test_logs)
+    
+    def fuzz_profile(self, program, prog_dir, vase_log):
+        """Append the logs of coverage-increasing generated inputs to vase_log"""
+        project_root = Path(__file__).parent.parent.resolve()
+        binary = (project_root / "benchmarks" / "coreutils-8.31" / "obj-llvm" /
+                  "instrumented" / f"{program}_final_exe")
+        script = Path(__file__).parent / "tools" / "analyzer" / "vase_fuzz.py"
+        # The corpus stays in prog_dir, so the next run starts from it
+        result = self.run_command(f"python3 {script} --binary {binary} --name {program} "
+                                  f"--log {vase_log} --corpus {prog_dir / 'fuzzCorpus'} "
+                                  f"--max-time {self.fuzz_time}")
+        print(result.stdout, end="")
+    
+    def merge_log_shards(self, shard_dir, vase_log):
+        """Append per-process log shards to vase_log and remove them"""
+        shards = sorted(shard_dir.glob("vase_value_log.*.txt"),
+                        key=lambda p: int(p.name.split(".")[1]))
+        with open(vase_log, "ab") as out:
+            for shard in shards:
+                with open(shard, "rb") as f:
+                    shutil.copyfileobj(f, out)
+        shutil.rmtree(shard_dir)
+        print(f"[OK] Merged {len(shards)} log shards into {vase_log}")
+    
     def validate_value_log(self, vase_log, program):
         """Validate VASE value log collection"""
         print(f"[VALIDATE] Checking value log for {program}")
@@ -370,10 +698,98 @@ class EVPPipeline:
         else:
             print(f"[ERROR] vase_value_log.txt not found in artifacts directory: {target_log}")
     
-    def phase3_evaluate(self, category, program, prog_dir, map_file):
+    def build_lib_map(self, category, prog_dirs):
+        """Pool the library-site records of all profiled programs of a category."""
+        lib_map = self.artifacts_dir / f"{category}.libMap.json"
+        thresholds = self.config[category]["thresholds"]
+        script = Path(__file__).parent / "tools" / "analyzer" / "build_lib_map.py"
+        phase2 = [self.cache_keys.get((category, d.name, 2)) for d in prog_dirs]
+        key = None
+        if self.cache and all(phase2):
+            key = self.cache.key("libmap", {"script": script, "thresholds": thresholds,
+                                            "phase2": phase2})
+        if self._cache_fetch(key, "Library map", self.artifacts_dir, category):
+            return lib_map
+        cmd = (f"python3 {script} --out {lib_map} "
+               f"--max-values {thresholds['max_values']} "
+               f"--min-occurrence {thresholds['min_occurrence']} "
+               + " ".join(str(d) for d in prog_dirs))
+        self.run_command(cmd)
+        if lib_map.exists():
+            self._cache_store(key, "Library map", self.artifacts_dir, [lib_map.name])
+        print(f"[OK] Generated library map -> {lib_map}")
+        return lib_map
+    
+    def phase3_evaluate(self, category, program, prog_dir, map_file, lib_map=None):
         """Phase 3: Run comprehensive KLEE evaluation with parallel execution"""
         print(f"\n[PHASE 3] Evaluating {program} with KLEE")
         
+        run = self._phase3_run(category, program, prog_dir, map_file, lib_map)
+        cached = self._phase3_cached(run)
+        if cached:
+            return self._phase3_finish(run, cached)
+        
+        # Run parallel KLEE evaluation
+        results = self.klee_runner.run_parallel_evaluation(
+            bitcode_path=run["bitcode"],
+            map_file=map_file,
+            program=program,
+            category=category,
+            run_id=run["run_id"],
+            extra_args=run["extra_args"],
+            test_env=run["test_env"],
+            vase_args=run["vase_args"],
+            vanilla_vase_args=run["vanilla_vase_args"]
+        )
+        return self._phase3_finish(run, results)
+    
+    def phase3_submit(self, scheduler, category, program, prog_dir, map_file, lib_map=None):
+        """
+        Phase 3 through the KLEE scheduler: queue both arms, see phase3_collect.
+        The run id is the phase-3 key, so a pipeline restarted with the same
+        inputs finds the runs the queue file kept (requeued or finished)
+        instead of queueing them again.
+        """
+        print(f"\n[PHASE 3] Queueing KLEE evaluation of {program}")
+        run = self._phase3_run(category, program, prog_dir, map_file, lib_map)
+        run["cached"] = self._phase3_cached(run)
+        if run["cached"]:
+            return run
+        run["run_id"] = self._phase3_key(run)[:16]
+        group = f"{category}/{program}-{run['run_id']}"
+        for arm, use_evp, vase_args in (("vanilla", False, run["vanilla_vase_args"]),
+                                        ("evp", True, run["vase_args"])):
+            output_dir = prog_dir / f"klee-{arm}-out-{run['run_id']}"
+            sandbox_dir = prog_dir / f"klee-{arm}-sandbox-{run['run_id']}"
+            self.klee_runner.prepare_sandbox(sandbox_dir)
+            cmd = self.klee_runner.klee_command(
+                run["bitcode"], output_dir, sandbox_dir, map_file, program, category,
+                run["extra_args"], run["test_env"], use_evp, vase_args)
+            scheduler.submit(f"{group}-{arm}", group, f"{category}/{program}", arm,
+                             cmd, output_dir, sandbox_dir)
+        return run
+    
+    def phase3_collect(self, scheduler, run):
+        """Results of a run queued by phase3_submit, once the scheduler is done"""
+        if run["cached"]:
+            return self._phase3_finish(run, run["cached"])
+        group = f"{run['category']}/{run['program']}-{run['run_id']}"
+        arms = {}
+        for arm in ("vanilla", "evp"):
+            job = scheduler.job(f"{group}-{arm}")
+            log = Path(f"{job['output_dir']}.log")
+            output = log.read_text(errors="ignore") if log.exists() else ""
+            exit_code = job["exit_code"] if job["exit_code"] is not None else -1
+            arms[arm] = (job["status"] == "done", output, exit_code)
+        prog_dir = run["prog_dir"]
+        results = self.klee_runner.evaluation_results(
+            run["program"], run["run_id"],
+            prog_dir / f"klee-vanilla-out-{run['run_id']}", prog_dir / f"klee-evp-out-{run['run_id']}",
+            arms["vanilla"], arms["evp"])
+        return self._phase3_finish(run, results)
+    
+    def _phase3_run(self, category, program, prog_dir, map_file, lib_map):
+        """KLEE inputs and flags shared by both arms of a phase-3 comparison"""
         base_bc = prog_dir / f"{program}.base.bc"
         
         # Get KLEE configuration for this category
@@ -394,16 +810,62 @@ class EVPPipeline:
         # Generate run ID
         run_id = datetime.now().strftime("%Y%m%d-%H%M%S")
         
-        # Run parallel KLEE evaluation
-        results = self.klee_runner.run_parallel_evaluation(
-            bitcode_path=base_bc,
-            map_file=map_file,
-            program=program,
-            category=category,
-            run_id=run_id,
-            extra_args=extra_klee_flags,
-            test_env=test_env
-        )
+        vase_args = [f"--vase-lib-map={lib_map}"] if lib_map else []
+        vanilla_vase_args = None
+        evp_stats = prog_dir / "siteStats.evp.json"
+        vanilla_stats = prog_dir / "siteStats.vanilla.json"
+        if self.prune:
+            # Same per-site accounting on both sides; the vanilla run only records
+            vase_args.append(f"--vase-site-stats={evp_stats}")
+            vanilla_vase_args = ["--use-vase", "--vase-profile-only",
+                                 f"--vase-site-stats={vanilla_stats}"]
+        
+        return {
+            "category": category, "program": program, "prog_dir": prog_dir,
+            "map_file": map_file, "lib_map": lib_map, "bitcode": base_bc, "run_id": run_id,
+            "extra_args": extra_klee_flags, "test_env": test_env,
+            "vase_args": vase_args, "vanilla_vase_args": vanilla_vase_args,
+            "evp_stats": evp_stats, "vanilla_stats": vanilla_stats
+        }
+    
+    def _phase3_key(self, run):
+        """Hash of everything a phase-3 comparison reads"""
+        klee = self.klee_runner
+        return self.hasher.key("phase3", {
+            "bitcode": run["bitcode"],
+            "map": run["map_file"],
+            "lib_map": run["lib_map"],
+            "klee": Path(klee.klee_bin),
+            "flags": klee.klee_flags_base,
+            "symbolic": klee.get_symbolic_input(run["program"], run["category"]),
+            "extra_args": run["extra_args"],
+            "test_env": run["test_env"],
+            "vase_args": [run["vase_args"], run["vanilla_vase_args"]],
+            "plateau": self.plateau_seconds
+        })
+    
+    def _phase3_cached(self, run):
+        """Results of an earlier run of the same KLEE comparison, restored into prog_dir"""
+        if not self.cache:
+            return None
+        key = run["cache_key"] = self._phase3_key(run)
+        manifest = self.cache.manifest(key)
+        if not manifest or not self._cache_fetch(key, "Phase 3", run["prog_dir"], run["program"]):
+            return None
+        name = next(n for n in manifest["files"] if n.startswith("klee_results_"))
+        with open(run["prog_dir"] / name) as f:
+            saved = json.load(f)
+        # The results of the stored run, under its run id
+        run["run_id"] = saved["run_id"]
+        results = {"program": saved["program"], "run_id": saved["run_id"]}
+        for arm in ("vanilla", "evp"):
+            results[arm] = dict(saved[arm], output="")
+        return results
+    
+    def _phase3_finish(self, run, results):
+        """Report and save a phase-3 comparison, then prune the map"""
+        prog_dir, map_file = run["prog_dir"], run["map_file"]
+        evp_stats, vanilla_stats = run["evp_stats"], run["vanilla_stats"]
         
         # Display results
         self.display_klee_results(results)
@@ -411,6 +873,21 @@ class EVPPipeline:
         # Save detailed results
         self.save_klee_results(results, prog_dir)
         
+        key = run.get("cache_key")
+        if key and results["vanilla"]["success"] and results["evp"]["success"]:
+            run_id = results["run_id"]
+            outputs = [Path(results[arm]["output_dir"]) for arm in ("vanilla", "evp")]
+            names = {p.relative_to(prog_dir).parts[0] for p in outputs}
+            names |= {f"{n}.log" for n in names}
+            names |= {f"klee_results_{run_id}.json", evp_stats.name, vanilla_stats.name}
+            self._cache_store(key, "Phase 3", prog_dir, sorted(names))
+        
+        if self.prune and evp_stats.exists():
+            prune_script = Path(__file__).parent / "tools" / "analyzer" / "prune_map.py"
+            self.run_command(f"python3 {prune_script} --map {map_file} "
+                             f"--decisions {prog_dir / 'prunedSites.json'} "
+                             f"--stats {evp_stats} --baseline {vanilla_stats}")
+        
         return results
     
     def display_klee_results(self, results):
@@ -424,11 +901,17 @@ class EVPPipeline:
         print(f"    - Exit code: {vanilla['exit_code']}")
         print(f"    - Test cases: {vanilla['ktest_count']}")
         print(f"    - Output dir: {vanilla['output_dir']}")
+        if vanilla.get('plateau'):
+            print(f"    - Coverage plateau: stopped at {vanilla['plateau']['stopped_wall_s']:.0f}s, "
+                  f"last progress at {vanilla['plateau']['last_progress_wall_s']:.0f}s")
         
         print(f"  EVP KLEE: {'SUCCESS' if evp['success'] else 'FAILED'}")
         print(f"    - Exit code: {evp['exit_code']}")
         print(f"    - Test cases: {evp['ktest_count']}")
         print(f"    - Output dir: {evp['output_dir']}")
+        if evp.get('plateau'):
+            print(f"    - Coverage plateau: stopped at {evp['plateau']['stopped_wall_s']:.0f}s, "
+                  f"last progress at {evp['plateau']['last_progress_wall_s']:.0f}s")
         
         # Compare performance metrics
         if vanilla['success'] and evp['success']:
@@ -448,14 +931,18 @@ class EVPPipeline:
                 "exit_code": results["vanilla"]["exit_code"],
                 "output_dir": results["vanilla"]["output_dir"],
                 "ktest_count": results["vanilla"]["ktest_count"],
-                "stats": results["vanilla"]["stats"]
+                "stats": results["vanilla"]["stats"],
+                "series": results["vanilla"].get("series", {}),
+                "plateau": results["vanilla"].get("plateau")
             },
             "evp": {
                 "success": results["evp"]["success"],
                 "exit_code": results["evp"]["exit_code"],
                 "output_dir": results["evp"]["output_dir"],
                 "ktest_count": results["evp"]["ktest_count"],
-                "stats": results["evp"]["stats"]
+                "stats": results["evp"]["stats"],
+                "series": results["evp"].get("series", {}),
+                "plateau": results["evp"].get("plateau")
             }
         }
         
@@ -540,12 +1027,20 @@ int main(int argc, char *argv[]) {{
             categories = list(self.config.keys())
         
         results = []
+        scheduler = None
+        if self.klee_scheduler:
+            scheduler = KLEEScheduler(self.artifacts_dir / "klee_queue.json",
+                                      memory_mb=self.klee_memory_mb,
+                                      plateau_seconds=self.plateau_seconds)
+        queued = []  # phase-3 runs handed to the scheduler
         for category in categories:
             if category not in self.config:
                 print(f"[SKIP] Unknown category: {category}")
                 continue
                 
             programs = self.config[category]["programs"]
+            instrumented = []  # (program, prog_dir) awaiting phase 2
+            profiled = []  # (program, prog_dir, map_file) awaiting phase 3
             for program in programs:
                 print(f"\n{'='*60}")
                 print(f"Processing {program} from {category}")
@@ -554,9 +1049,15 @@ int main(int argc, char *argv[]) {{
                 try:
                     # Phase 1: Instrument
                     prog_dir = self.phase1_instrument(category, program)
+                    if self.profile_jobs > 1:
+                        instrumented.append((program, prog_dir))
+                        continue
                     
                     # Phase 2: Profile
                     map_file = self.phase2_profile(category, program, prog_dir)
+                    if self.lib_map or scheduler:
+                        profiled.append((program, prog_dir, map_file))
+                        continue
                     
                     # Phase 3: Evaluate
                     self.phase3_evaluate(category, program, prog_dir, map_file)
@@ -565,6 +1066,55 @@ int main(int argc, char *argv[]) {{
                 except Exception as e:
                     print(f"[ERROR] Failed processing {program}: {e}")
                     results.append({"program": program, "category": category, "status": "failed", "error": str(e)})
+            
+            # Phase 2 of up to VASE_PROFILE_JOBS programs at once
+            if instrumented:
+                with ThreadPoolExecutor(max_workers=self.profile_jobs) as pool:
+                    futures = [(program, prog_dir,
+                                pool.submit(self.phase2_profile, category, program, prog_dir))
+                               for program, prog_dir in instrumented]
+                for program, prog_dir, future in futures:
+                    try:
+                        profiled.append((program, prog_dir, future.result()))
+                    except Exception as e:
+                        print(f"[ERROR] Failed processing {program}: {e}")
+                        results.append({"program": program, "category": category, "status": "failed", "error": str(e)})
+            
+            if not profiled:
+                continue
+            lib_map = None
+            if self.lib_map:
+                try:
+                    lib_map = self.build_lib_map(category, [d for _, d, _ in profiled])
+                except Exception as e:
+                    print(f"[ERROR] Failed building library map for {category}: {e}")
+            for program, prog_dir, map_file in profiled:
+                try:
+                    if scheduler:
+                        queued.append(self.phase3_submit(scheduler, category, program, prog_dir,
+                                                         map_file, lib_map))
+                        continue
+                    self.phase3_evaluate(category, program, prog_dir, map_file, lib_map)
+                    results.append({"program": program, "category": category, "status": "success"})
+                except Exception as e:
+                    print(f"[ERROR] Failed processing {program}: {e}")
+                    results.append({"program": program, "category": category, "status": "failed", "error": str(e)})
+        
+        # Phase 3 of all categories at once; runs queued by an earlier pipeline
+        # that this one did not submit again have no one to collect them
+        if scheduler:
+            scheduler.drop_pending({f"{r['category']}/{r['program']}-{r['run_id']}-{arm}"
+                                    for r in queued for arm in ("vanilla", "evp")})
+        if queued:
+            scheduler.run()
+        for run in queued:
+            program, category = run["program"], run["category"]
+            try:
+                self.phase3_collect(scheduler, run)
+                results.append({"program": program, "category": category, "status": "success"})
+            except Exception as e:
+                print(f"[ERROR] Failed processing {program}: {e}")
+                results.append({"program": program, "category": category, "status": "failed", "error": str(e)})
         
         # Save results
         self.save_results(results)
@@ -7,23 +7,40 @@ and provides a Python interface for running both vanilla and EVP-enabled KLEE.
 """
 
 import os
+import signal
 import subprocess
 import tempfile
+import threading
+import time
 import shutil
 from pathlib import Path
 from datetime import datetime
-from typing import Dict, List, Optional, Tuple
+from typing import Callable, Dict, List, Optional, Tuple
 import json
 
+from klee_stats import PlateauRule, RunStatsTail, format_row, read_plateau
+
 
 class KLEERunner:
     """Handles KLEE execution for both vanilla and EVP-enabled runs"""
     
+    # run.stats of running KLEE is read this often, and reported this often
+    STATS_POLL_SECONDS = 5
+    LIVE_REPORT_SECONDS = 60
+    
     def __init__(self, klee_bin: str, project_root: Path, config: dict = None):
         self.klee_bin = klee_bin
         self.project_root = project_root
         self.config = config or {}
         
+        # Output dir -> run.stats of every run started here, updated while
+        # KLEE runs (klee_stats.RunStatsTail)
+        self.live: Dict[str, RunStatsTail] = {}
+        
+        # Stop a run after this many seconds without new coverage or tests
+        # (klee_stats.PlateauRule; 0 = run out --max-time)
+        self.plateau_seconds = 0.0
+        
         # Base KLEE flags from step3_generic.sh
         self.klee_flags_base = [
             "--libc=uclibc", "--posix-runtime", "--simplify-sym-indices", 
@@ -331,7 +348,11 @@ class KLEERunner:
                  extra_args: List[str] = None,
                  test_env: Optional[Path] = None,
                  run_id: str = "",
-                 use_evp: bool = False) -> Tuple[bool, str, int]:
+                 use_evp: bool = False,
+                 vase_args: List[str] = None,
+                 max_time: Optional[str] = None,
+                 on_stats: Optional[Callable[[Dict[str, RunStatsTail]], None]] = None
+                 ) -> Tuple[bool, str, int]:
         """
         Run KLEE on the given bitcode
         
@@ -344,6 +365,10 @@ class KLEERunner:
             test_env: Path to test environment file
             run_id: Run identifier for logging
             use_evp: Whether to use EVP/VASE features
+            vase_args: Extra VaseSolver flags (e.g. --vase-site-stats=...)
+            max_time: Overrides the base --max-time (e.g. "120s")
+            on_stats: Called with the followed stats, by arm ("vanilla" or
+                "evp"), whenever new rows arrive
             
         Returns:
             Tuple of (success, output, exit_code)
@@ -360,56 +385,63 @@ class KLEERunner:
                 shutil.rmtree(output_dir)
             output_dir.mkdir(parents=True)
             
-            # Build KLEE command
-            cmd = [self.klee_bin]
-            
-            # Add base flags
-            cmd.extend(self.klee_flags_base)
-            
-            # Add EVP-specific flags
-            if use_evp and map_file:
-                cmd.extend(["--use-vase", f"--vase-map={map_file}"])
-            
-            # Add test environment if provided
-            if test_env and test_env.exists():
-                cmd.append(f"--env-file={test_env}")
-            
-            # Add sandbox directory
-            cmd.append(f"--run-in-dir={sandbox_dir}")
-            
-            # Add output directory
-            cmd.append(f"--output-dir={output_dir}")
-            
-            # Add bitcode file
-            cmd.append(str(bitcode_path))
-            
-            # Add symbolic input configuration
-            symbolic_input = self.get_symbolic_input(program, category)
-            cmd.extend(symbolic_input.split())
-            
-            # Add extra program arguments
-            cmd.extend(extra_args)
+            cmd = self.klee_command(bitcode_path, output_dir, Path(sandbox_dir), map_file,
+                                    program, category, extra_args, test_env, use_evp,
+                                    vase_args, max_time)
             
             # Run KLEE
             print(f"[RUN] {'EVP' if use_evp else 'Vanilla'} KLEE on {program}")
             print(f"[CMD] {' '.join(cmd)}")
             
+            label = "evp" if use_evp else "vanilla"
+            tails = {label: RunStatsTail(output_dir)}
+            self.live[str(output_dir)] = tails[label]
+            rule = PlateauRule(self.plateau_seconds) if self.plateau_seconds > 0 else None
+            stopped = False
+            
             try:
-                result = subprocess.run(
-                    cmd, 
-                    capture_output=True, 
-                    text=True, 
-                    timeout=1800  # 30 minutes timeout
-                )
+                proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                        text=True, errors="replace")
+                # Drain KLEE's output while following its run.stats
+                chunks = []
+                reader = threading.Thread(target=lambda: chunks.extend(proc.stdout), daemon=True)
+                reader.start()
+                deadline = time.monotonic() + 1800  # 30 minutes timeout
+                reported = time.monotonic()
+                while proc.poll() is None:
+                    try:
+                        proc.wait(timeout=self.STATS_POLL_SECONDS)
+                    except subprocess.TimeoutExpired:
+                        pass
+                    if time.monotonic() > deadline and proc.poll() is None:
+                        proc.kill()
+                        proc.wait()
+                        raise subprocess.TimeoutExpired(cmd, 1800)
+                    new_rows = [bool(tail.poll()) for tail in tails.values()]
+                    if any(new_rows) and on_stats:
+                        on_stats(tails)
+                    if rule and not stopped and rule.update(tails[label], output_dir) and \
+                            self.interrupt(proc):
+                        stopped = True
+                        rule.record(output_dir)
+                        print(f"[PLATEAU] {program} {label}: no new coverage or tests for "
+                              f"{rule.seconds:.0f}s, stopped at {rule.point['stopped_wall_s']:.0f}s")
+                    if time.monotonic() - reported >= self.LIVE_REPORT_SECONDS:
+                        reported = time.monotonic()
+                        print(f"[LIVE] {program}: " + " | ".join(
+                            f"{label} {format_row(tail.latest())}" for label, tail in tails.items()))
+                reader.join()
+                for tail in tails.values():
+                    tail.poll()
                 
-                success = result.returncode == 0
-                output = result.stdout + result.stderr
+                success = proc.returncode == 0
+                output = "".join(chunks)
                 
                 # Count generated test cases
                 ktest_count = len(list(output_dir.glob("test*.ktest")))
                 print(f"[OK] {'EVP' if use_evp else 'Vanilla'} KLEE completed; generated {ktest_count} ktests")
                 
-                return success, output, result.returncode
+                return success, output, proc.returncode
                 
             except subprocess.TimeoutExpired:
                 print(f"[TIMEOUT] {'EVP' if use_evp else 'Vanilla'} KLEE timed out after 30 minutes")
@@ -418,6 +450,89 @@ class KLEERunner:
                 print(f"[ERROR] {'EVP' if use_evp else 'Vanilla'} KLEE failed: {e}")
                 return False, str(e), -1
     
+    @staticmethod
+    def interrupt(proc: subprocess.Popen) -> bool:
+        """
+        SIGINT a running KLEE, which then halts and writes its tests and stats
+        as at --max-time. False if the process was gone.
+        """
+        try:
+            os.kill(proc.pid, signal.SIGINT)
+        except OSError:
+            return False
+        return True
+    
+    def klee_command(self,
+                     bitcode_path: Path,
+                     output_dir: Path,
+                     sandbox_dir: Path,
+                     map_file: Optional[Path] = None,
+                     program: str = "",
+                     category: str = "",
+                     extra_args: List[str] = None,
+                     test_env: Optional[Path] = None,
+                     use_evp: bool = False,
+                     vase_args: List[str] = None,
+                     max_time: Optional[str] = None) -> List[str]:
+        """KLEE command line of one run (arguments as for run_klee)"""
+        cmd = [self.klee_bin]
+        
+        # Add base flags
+        if max_time:
+            cmd.extend(f for f in self.klee_flags_base if not f.startswith("--max-time="))
+            cmd.append(f"--max-time={max_time}")
+        else:
+            cmd.extend(self.klee_flags_base)
+        
+        # Add EVP-specific flags
+        if use_evp and map_file:
+            cmd.extend(["--use-vase", f"--vase-map={map_file}"])
+        if vase_args:
+            cmd.extend(vase_args)
+        
+        # Add test environment if provided
+        if test_env and test_env.exists():
+            cmd.append(f"--env-file={test_env}")
+        
+        # Add sandbox directory
+        cmd.append(f"--run-in-dir={sandbox_dir}")
+        
+        # Add output directory
+        cmd.append(f"--output-dir={output_dir}")
+        
+        # Add bitcode file
+        cmd.append(str(bitcode_path))
+        
+        # Add symbolic input configuration
+        symbolic_input = self.get_symbolic_input(program, category)
+        cmd.extend(symbolic_input.split())
+        
+        # Add extra program arguments
+        cmd.extend(extra_args or [])
+        return cmd
+    
+    def profile_sites(self,
+                      bitcode_path: Path,
+                      stats_file: Path,
+                      program: str,
+                      category: str = "",
+                      max_time: str = "120s",
+                      test_env: Optional[Path] = None) -> bool:
+        """
+        Short vanilla KLEE run that records per-site query counts and solver
+        time (--vase-site-stats) without rewriting anything. The pass reads
+        stats_file back with -vase-hot-sites to instrument only hot sites.
+        """
+        out_dir = bitcode_path.parent / "klee-site-stats-out"
+        success, output, _ = self.run_klee(
+            bitcode_path, out_dir, None, program, category, [], test_env, "", False,
+            vase_args=["--use-vase", "--vase-profile-only", f"--vase-site-stats={stats_file}"],
+            max_time=max_time)
+        if not stats_file.exists():
+            print(f"[WARNING] No site stats written to {stats_file}")
+            return False
+        return True
+    
     def run_parallel_evaluation(self,
                                bitcode_path: Path,
                                map_file: Path,
@@ -425,7 +540,9 @@ class KLEERunner:
                                category: str = "",
                                run_id: str = "",
                                extra_args: List[str] = None,
-                               test_env: Optional[Path] = None) -> Dict:
+                               test_env: Optional[Path] = None,
+                               vase_args: List[str] = None,
+                               vanilla_vase_args: List[str] = None) -> Dict:
         """
         Run both vanilla and EVP KLEE in parallel and return results
         
@@ -436,6 +553,9 @@ class KLEERunner:
             run_id: Run identifier
             extra_args: Extra program arguments
             test_env: Path to test environment file
+            vase_args: Extra VaseSolver flags for the EVP run
+            vanilla_vase_args: VaseSolver flags for the vanilla run (e.g.
+                --use-vase --vase-profile-only --vase-site-stats=...)
             
         Returns:
             Dictionary with results from both runs
@@ -455,13 +575,25 @@ class KLEERunner:
         
         # Run both variants
         vanilla_success, vanilla_output, vanilla_exit = self.run_klee(
-            bitcode_path, vanilla_out, None, program, category, extra_args, test_env, run_id, False
+            bitcode_path, vanilla_out, None, program, category, extra_args, test_env, run_id, False,
+            vanilla_vase_args
         )
         
         evp_success, evp_output, evp_exit = self.run_klee(
-            bitcode_path, evp_out, map_file, program, category, extra_args, test_env, run_id, True
+            bitcode_path, evp_out, map_file, program, category, extra_args, test_env, run_id, True,
+            vase_args
         )
         
+        return self.evaluation_results(program, run_id, vanilla_out, evp_out,
+                                       (vanilla_success, vanilla_output, vanilla_exit),
+                                       (evp_success, evp_output, evp_exit))
+    
+    def evaluation_results(self, program: str, run_id: str, vanilla_out: Path, evp_out: Path,
+                           vanilla_run: Tuple[bool, str, int], evp_run: Tuple[bool, str, int]) -> Dict:
+        """Results of a vanilla/EVP pair from their (success, output, exit_code)"""
+        vanilla_success, vanilla_output, vanilla_exit = vanilla_run
+        evp_success, evp_output, evp_exit = evp_run
+        
         # Parse results
         vanilla_stats = self.parse_klee_stats(vanilla_out / "info")
         evp_stats = self.parse_klee_stats(evp_out / "info")
@@ -470,6 +602,16 @@ class KLEERunner:
         vanilla_ktests = len(list(vanilla_out.glob("test*.ktest"))) if vanilla_out.exists() else 0
         evp_ktests = len(list(evp_out.glob("test*.ktest"))) if evp_out.exists() else 0
         
+        # Time series from run.stats, as followed during the run or read now
+        # (runs of the scheduler)
+        series = {}
+        for arm, out in (("vanilla", vanilla_out), ("evp", evp_out)):
+            tail = self.live.pop(str(out), None)
+            if tail is None:
+                tail = RunStatsTail(out)
+                tail.poll()
+            series[arm] = tail.summary()
+        
         return {
             "program": program,
             "run_id": run_id,
@@ -479,6 +621,8 @@ class KLEERunner:
                 "output_dir": str(vanilla_out),
                 "ktest_count": vanilla_ktests,
                 "stats": vanilla_stats,
+                "series": series["vanilla"],
+                "plateau": read_plateau(vanilla_out),
                 "output": vanilla_output
             },
             "evp": {
@@ -487,6 +631,8 @@ class KLEERunner:
                 "output_dir": str(evp_out),
                 "ktest_count": evp_ktests,
                 "stats": evp_stats,
+                "series": series["evp"],
+                "plateau": read_plateau(evp_out),
                 "output": evp_output
             }
         }
@@ -0,0 +1,380 @@
+#!/usr/bin/env python3
+"""
+KLEE Scheduler Module for EVP Pipeline
+
+Packs the phase-3 KLEE runs of many programs onto the cores and RAM of one
+machine instead of running them one after the other:
+
+- Admission control: a run starts only when a core is free and its memory
+  estimate fits the budget next to the running ones, each counted at the
+  larger of its estimate and its actual RSS (process tree, /proc). The
+  estimate is the run's --max-memory, or the peak RSS earlier runs of the
+  same program and arm reached, if higher.
+- CPU pinning: every run gets a core of its own; the vanilla and EVP arms of
+  a comparison start together on cores of the same CPU package.
+- Persistent queue: every state change is written to a JSON queue file, so a
+  restarted scheduler (this module's main, or the pipeline) picks up where
+  it stopped. Runs left "running" by a dead scheduler are killed and redone.
+- Live statistics: the run.stats of every running run is followed
+  (klee_stats.py); its latest row is kept in the queue file as "live", and
+  the arms of each group are reported side by side while they run.
+- Coverage plateau: with plateau_seconds, a run that went that long without
+  new coverage or tests is interrupted (SIGINT: KLEE halts and writes its
+  output) and its plateau point kept as "plateau".
+"""
+
+import json
+import os
+import shutil
+import signal
+import subprocess
+import sys
+import time
+from pathlib import Path
+from typing import Dict, List, Optional, Set
+
+from klee_stats import SUMMARY_COLUMNS, PlateauRule, RunStatsTail, format_row
+
+
+def read_meminfo() -> Dict[str, int]:
+    """/proc/meminfo in MB"""
+    info = {}
+    try:
+        with open("/proc/meminfo") as f:
+            for line in f:
+                key, _, rest = line.partition(":")
+                info[key] = int(rest.split()[0]) // 1024
+    except (OSError, ValueError, IndexError):
+        pass
+    return info
+
+
+def tree_rss_mb(pid: int) -> int:
+    """Resident memory of a process and its descendants (forked solvers)"""
+    total_kb, todo, seen = 0, [pid], set()
+    while todo:
+        p = todo.pop()
+        if p in seen:
+            continue
+        seen.add(p)
+        try:
+            with open(f"/proc/{p}/status") as f:
+                for line in f:
+                    if line.startswith("VmRSS:"):
+                        total_kb += int(line.split()[1])
+                        break
+            for task in os.listdir(f"/proc/{p}/task"):
+                with open(f"/proc/{p}/task/{task}/children") as f:
+                    todo.extend(int(c) for c in f.read().split())
+        except (OSError, ValueError):
+            continue
+    return total_kb // 1024
+
+
+def cpu_packages(cpus: Set[int]) -> Dict[int, int]:
+    """cpu -> physical package id"""
+    packages = {}
+    for cpu in cpus:
+        try:
+            with open(f"/sys/devices/system/cpu/cpu{cpu}/topology/physical_package_id") as f:
+                packages[cpu] = int(f.read())
+        except (OSError, ValueError):
+            packages[cpu] = 0
+    return packages
+
+
+def flag_value(cmd: List[str], flag: str) -> Optional[str]:
+    """Value of the last --flag=VALUE in cmd"""
+    value = None
+    for arg in cmd:
+        if arg.startswith(flag + "="):
+            value = arg.split("=", 1)[1]
+    return value
+
+
+class KLEEScheduler:
+    """Resource-aware queue of KLEE runs"""
+
+    POLL_SECONDS = 1.0
+    LIVE_SECONDS = 60.0   # live stats written to the queue and reported
+
+    def __init__(self,
+                 queue_file: Path,
+                 cores: Optional[Set[int]] = None,
+                 memory_mb: Optional[int] = None,
+                 reserve_mb: int = 1024,
+                 plateau_seconds: float = 0):
+        """
+        Args:
+            queue_file: JSON file holding the queue across restarts
+            cores: CPUs to run on (default: this process's affinity)
+            memory_mb: Memory budget for all runs (default: 90% of MemTotal)
+            reserve_mb: MemAvailable to leave free when admitting a run
+            plateau_seconds: Stop runs this long without new coverage or
+                tests (0: let them run out --max-time)
+        """
+        self.queue_file = Path(queue_file)
+        self.cores = set(cores) if cores else set(os.sched_getaffinity(0))
+        self.packages = cpu_packages(self.cores)
+        self.memory_mb = memory_mb or int(read_meminfo().get("MemTotal", 0) * 0.9)
+        self.reserve_mb = reserve_mb
+        self.plateau_seconds = plateau_seconds
+        self.jobs: List[Dict] = []
+        self.procs: Dict[str, subprocess.Popen] = {}
+        self.tails: Dict[str, RunStatsTail] = {}  # job id -> stats of a running job
+        self.rules: Dict[str, PlateauRule] = {}
+        self.live_reported = time.monotonic()
+        self.load()
+
+    # ---- Queue file -------------------------------------------------------
+
+    def load(self) -> None:
+        if not self.queue_file.exists():
+            return
+        with open(self.queue_file) as f:
+            self.jobs = json.load(f).get("jobs", [])
+        for job in self.jobs:
+            if job["status"] != "running":
+                continue
+            # Left behind by a scheduler that died; its output is incomplete
+            pid = job.get("pid")
+            if pid and self._is_job_process(pid, job):
+                try:
+                    os.killpg(pid, signal.SIGKILL)
+                except OSError:
+                    pass
+            job["status"] = "pending"
+            print(f"[SCHED] Requeued interrupted run {job['id']}")
+        self.save()
+
+    def save(self) -> None:
+        tmp = self.queue_file.with_suffix(".tmp")
+        with open(tmp, "w") as f:
+            json.dump({"jobs": self.jobs}, f, indent=2)
+        os.replace(tmp, self.queue_file)
+
+    @staticmethod
+    def _is_job_process(pid: int, job: Dict) -> bool:
+        try:
+            with open(f"/proc/{pid}/cmdline", "rb") as f:
+                cmdline = f.read().decode(errors="ignore")
+        except OSError:
+            return False
+        return f"--output-dir={job['output_dir']}" in cmdline
+
+    # ---- Submission -------------------------------------------------------
+
+    def submit(self, job_id: str, group: str, program: str, arm: str,
+               cmd: List[str], output_dir: Path, sandbox_dir: Path) -> Dict:
+        """
+        Queue one KLEE run. A job already queued under job_id is kept as is,
+        finished ones too while their output exists; job ids should name the
+        run's inputs, so that a resubmission after a restart finds it.
+
+        Args:
+            job_id: Unique run id
+            group: Runs of one group (the arms of a comparison) start together
+            program: Program name, for memory estimates from earlier runs
+            arm: "vanilla" or "evp"
+            cmd: Full KLEE command (KLEERunner.klee_command)
+            output_dir: KLEE --output-dir
+            sandbox_dir: KLEE --run-in-dir, prepared by the caller
+        """
+        for job in self.jobs:
+            if job["id"] != job_id:
+                continue
+            if job["status"] in ("done", "failed") and not Path(job["output_dir"]).exists():
+                job.update(status="pending", exit_code=None, pid=None, cpu=None,
+                           started=None, finished=None)
+                self.save()
+            return job
+        job = {
+            "id": job_id, "group": group, "program": program, "arm": arm,
+            "cmd": cmd, "output_dir": str(output_dir), "sandbox_dir": str(sandbox_dir),
+            "status": "pending", "exit_code": None, "peak_rss_mb": 0,
+            "cpu": None, "pid": None, "started": None, "finished": None
+        }
+        self.jobs.append(job)
+        self.save()
+        return job
+
+    def job(self, job_id: str) -> Optional[Dict]:
+        return next((j for j in self.jobs if j["id"] == job_id), None)
+
+    def drop_pending(self, keep: Set[str]) -> None:
+        """Remove pending jobs not in keep: left by a run whose inputs changed"""
+        dropped = [j for j in self.jobs if j["status"] == "pending" and j["id"] not in keep]
+        if not dropped:
+            return
+        for job in dropped:
+            print(f"[SCHED] Dropped pending run {job['id']}: not submitted again")
+        self.jobs = [j for j in self.jobs if j not in dropped]
+        self.save()
+
+    # ---- Resources --------------------------------------------------------
+
+    def estimate_mb(self, job: Dict) -> int:
+        declared = int(flag_value(job["cmd"], "--max-memory") or 2000)
+        seen = [j["peak_rss_mb"] for j in self.jobs
+                if j["program"] == job["program"] and j["arm"] == job["arm"] and j["status"] == "done"]
+        return max([declared] + seen)
+
+    def timeout_seconds(self, job: Dict) -> float:
+        max_time = (flag_value(job["cmd"], "--max-time") or "1800s").rstrip("s")
+        try:
+            return float(max_time) * 1.1 + 60
+        except ValueError:
+            return 1800 * 1.1 + 60
+
+    def committed_mb(self) -> int:
+        return sum(max(self.estimate_mb(j), j["peak_rss_mb"])
+                   for j in self.jobs if j["status"] == "running")
+
+    def free_cores(self) -> Set[int]:
+        return self.cores - {j["cpu"] for j in self.jobs if j["status"] == "running"}
+
+    def pick_cores(self, n: int) -> Optional[List[int]]:
+        """n free cores of one package, lowest numbered first"""
+        free = self.free_cores()
+        for package in sorted(set(self.packages.values())):
+            cores = sorted(c for c in free if self.packages[c] == package)
+            if len(cores) >= n:
+                return cores[:n]
+        return None
+
+    # ---- Running ----------------------------------------------------------
+
+    def launch(self, job: Dict, cpu: int) -> None:
+        output_dir = Path(job["output_dir"])
+        if output_dir.exists():
+            shutil.rmtree(output_dir)
+        output_dir.parent.mkdir(parents=True, exist_ok=True)
+        Path(job["sandbox_dir"]).mkdir(parents=True, exist_ok=True)
+        log = open(f"{job['output_dir']}.log", "w")
+        proc = subprocess.Popen(job["cmd"], stdout=log, stderr=subprocess.STDOUT,
+                                start_new_session=True,
+                                preexec_fn=lambda: os.sched_setaffinity(0, {cpu}))
+        log.close()
+        self.procs[job["id"]] = proc
+        self.tails[job["id"]] = RunStatsTail(output_dir)
+        if self.plateau_seconds > 0:
+            self.rules[job["id"]] = PlateauRule(self.plateau_seconds)
+        job.update(status="running", cpu=cpu, pid=proc.pid, started=time.time(),
+                   peak_rss_mb=0, exit_code=None, finished=None, live={}, plateau=None)
+        print(f"[SCHED] Started {job['id']} on cpu {cpu} (estimate {self.estimate_mb(job)} MB)")
+
+    def admit(self) -> bool:
+        """Start every pending group that fits now; True if any started"""
+        started = False
+        groups: Dict[str, List[Dict]] = {}
+        for job in self.jobs:
+            if job["status"] == "pending":
+                groups.setdefault(job["group"], []).append(job)
+        for group_jobs in groups.values():
+            need = sum(self.estimate_mb(j) for j in group_jobs)
+            idle = not any(j["status"] == "running" for j in self.jobs)
+            available = read_meminfo().get("MemAvailable", need + self.reserve_mb)
+            fits = (self.committed_mb() + need <= self.memory_mb and
+                    available - need >= self.reserve_mb)
+            # A group too big for the budget still runs, alone
+            if not fits and not idle:
+                continue
+            cores = self.pick_cores(len(group_jobs))
+            if cores is None and idle and len(group_jobs) > len(self.cores):
+                # More arms than cores: share them rather than never run
+                cores = [sorted(self.cores)[i % len(self.cores)] for i in range(len(group_jobs))]
+            if cores is None:
+                continue
+            for job, cpu in zip(group_jobs, cores):
+                self.launch(job, cpu)
+            started = True
+        return started
+
+    def poll(self) -> bool:
+        """Update running jobs; True if any finished"""
+        finished = False
+        for job in self.jobs:
+            if job["status"] != "running":
+                continue
+            proc = self.procs[job["id"]]
+            job["peak_rss_mb"] = max(job["peak_rss_mb"], tree_rss_mb(proc.pid))
+            self.follow_stats(job)
+            if proc.poll() is None and time.time() - job["started"] > self.timeout_seconds(job):
+                print(f"[TIMEOUT] {job['id']} killed after {self.timeout_seconds(job):.0f}s")
+                os.killpg(proc.pid, signal.SIGKILL)
+                proc.wait()
+            if proc.poll() is None:
+                continue
+            job.update(status="done" if proc.returncode == 0 else "failed",
+                       exit_code=proc.returncode, finished=time.time(), pid=None)
+            del self.procs[job["id"]]
+            self.follow_stats(job)
+            del self.tails[job["id"]]
+            self.rules.pop(job["id"], None)
+            shutil.rmtree(job["sandbox_dir"], ignore_errors=True)
+            print(f"[SCHED] {job['id']} {job['status']} (exit {proc.returncode}, "
+                  f"peak RSS {job['peak_rss_mb']} MB, {job['finished'] - job['started']:.0f}s)")
+            finished = True
+        return finished
+
+    def follow_stats(self, job: Dict) -> None:
+        """Read the rows KLEE added to the job's run.stats since the last poll"""
+        tail = self.tails[job["id"]]
+        if not tail.poll():
+            return
+        latest = tail.latest()
+        job["live"] = {c: latest[c] for c in SUMMARY_COLUMNS if c in latest}
+        rule = self.rules.get(job["id"])
+        if rule and job.get("plateau") is None and job["pid"] and \
+                rule.update(tail, Path(job["output_dir"])):
+            try:
+                os.kill(job["pid"], signal.SIGINT)
+            except OSError:
+                return
+            rule.record(Path(job["output_dir"]))
+            job["plateau"] = rule.point
+            print(f"[PLATEAU] {job['id']}: no new coverage or tests for {rule.seconds:.0f}s, "
+                  f"stopped at {rule.point['stopped_wall_s']:.0f}s")
+    
+    def series(self, job_id: str) -> Dict[str, List[float]]:
+        """Time series of a running job's stats so far"""
+        tail = self.tails.get(job_id)
+        return tail.summary() if tail else {}
+    
+    def report_live(self) -> None:
+        """Latest stats of the running jobs, arms of a group on one line"""
+        groups: Dict[str, List[Dict]] = {}
+        for job in self.jobs:
+            if job["status"] == "running":
+                groups.setdefault(job["group"], []).append(job)
+        for group, jobs in sorted(groups.items()):
+            print(f"[LIVE] {group}: " + " | ".join(
+                f"{j['arm']} {format_row(j.get('live'))}" for j in jobs))
+    
+    def run(self) -> None:
+        """Run the queue until no job is pending or running"""
+        print(f"[SCHED] {len(self.cores)} cores, {self.memory_mb} MB budget, queue {self.queue_file}")
+        try:
+            while any(j["status"] in ("pending", "running") for j in self.jobs):
+                changed = self.poll()
+                changed |= self.admit()
+                if time.monotonic() - self.live_reported >= self.LIVE_SECONDS:
+                    self.live_reported = time.monotonic()
+                    self.report_live()
+                    changed = True
+                if changed:
+                    self.save()
+                elif not self.procs:
+                    print("[SCHED] Pending runs cannot be placed on the given cores")
+                    break
+                time.sleep(self.POLL_SECONDS)
+        finally:
+            self.save()
+
+
+if __name__ == "__main__":
+    # Resume a queue left by an interrupted pipeline run
+    if len(sys.argv) != 2:
+        print(f"Usage: {sys.argv[0]} QUEUE_FILE")
+        sys.exit(1)
+    KLEEScheduler(Path(sys.argv[1])).run()
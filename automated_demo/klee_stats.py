@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""
+KLEE Statistics Streaming Module for EVP Pipeline
+
+Follows the run.stats of a KLEE run while it is running, instead of reading
+the final numbers from `info` or exported CSVs once it has exited. KLEE
+appends a row every --stats-write-interval (1s by default); the rows read so
+far are kept in memory as time series, one list per column.
+
+Both run.stats formats are read: the SQLite database of KLEE 2.x (table
+"stats", read-only, while KLEE keeps writing) and the text format of older
+releases (a tuple of column names, then one tuple of values per line, times
+in seconds, converted here to the microseconds of KLEE 2.x).
+
+PlateauRule decides from these rows when a run stopped making progress.
+"""
+
+import ast
+import json
+import sqlite3
+import sys
+import time
+from pathlib import Path
+from typing import Dict, List, Optional
+
+SQLITE_MAGIC = b"SQLite format 3\0"
+
+# Columns compared across arms and kept in result files; WallTime and the
+# *Time columns are in microseconds
+SUMMARY_COLUMNS = ["WallTime", "Instructions", "CoveredInstructions", "UncoveredInstructions",
+                   "NumStates", "NumQueries", "SolverTime", "QueryTime", "MallocUsage"]
+
+
+class RunStatsTail:
+    """Incremental reader of one KLEE output directory's run.stats"""
+
+    def __init__(self, output_dir: Path):
+        self.path = Path(output_dir) / "run.stats"
+        self.series: Dict[str, List[float]] = {}
+        self.rows = 0
+        self.last_rowid = 0   # SQLite: last row read
+        self.offset = 0       # text: bytes of complete lines read
+        self.columns: Optional[List[str]] = None
+
+    def poll(self) -> List[Dict[str, float]]:
+        """Rows KLEE wrote since the last poll (none while run.stats is missing)"""
+        try:
+            with open(self.path, "rb") as f:
+                sqlite = f.read(len(SQLITE_MAGIC)) == SQLITE_MAGIC
+        except OSError:
+            return []
+        rows = self._poll_sqlite() if sqlite else self._poll_text()
+        for row in rows:
+            for column, value in row.items():
+                self.series.setdefault(column, []).append(value)
+        self.rows += len(rows)
+        return rows
+
+    def _poll_sqlite(self) -> List[Dict[str, float]]:
+        try:
+            db = sqlite3.connect(f"file:{self.path}?mode=ro", uri=True, timeout=1.0)
+        except sqlite3.Error:
+            return []
+        try:
+            cursor = db.execute("SELECT rowid, * FROM stats WHERE rowid > ? ORDER BY rowid",
+                                (self.last_rowid,))
+            columns = [d[0] for d in cursor.description][1:]
+            rows = []
+            for record in cursor:
+                self.last_rowid = record[0]
+                rows.append(dict(zip(columns, record[1:])))
+            return rows
+        except sqlite3.Error:
+            # Table not created yet, or KLEE holds the write lock: next poll
+            return []
+        finally:
+            db.close()
+
+    def _poll_text(self) -> List[Dict[str, float]]:
+        with open(self.path, "rb") as f:
+            f.seek(self.offset)
+            data = f.read()
+        # Only lines KLEE has finished writing
+        end = data.rfind(b"\n") + 1
+        self.offset += end
+        rows = []
+        for line in data[:end].decode(errors="ignore").splitlines():
+            try:
+                values = ast.literal_eval(line.strip())
+            except (ValueError, SyntaxError):
+                continue
+            if self.columns is None:
+                self.columns = [str(v) for v in values]
+            elif isinstance(values, tuple):
+                row = dict(zip(self.columns, values))
+                for column in row:
+                    if column.endswith("Time"):
+                        row[column] = int(row[column] * 1e6)
+                rows.append(row)
+        return rows
+
+    def latest(self) -> Dict[str, float]:
+        """Most recent value of every column"""
+        return {column: values[-1] for column, values in self.series.items() if values}
+
+    def summary(self, columns: List[str] = None) -> Dict[str, List[float]]:
+        """Time series of the given columns (default: SUMMARY_COLUMNS)"""
+        return {c: self.series[c] for c in (columns or SUMMARY_COLUMNS) if c in self.series}
+
+
+class PlateauRule:
+    """
+    Coverage plateau of one run: `seconds` of KLEE wall time in which neither
+    CoveredInstructions grew nor a test case was written. The same rule is
+    applied to every arm of a comparison, each on its own clock.
+    """
+
+    def __init__(self, seconds: float):
+        self.seconds = seconds
+        self.covered = -1
+        self.tests = -1
+        self.progress_at = 0.0    # wall time (s) of the last new coverage or test
+        self.point: Optional[Dict] = None
+
+    def update(self, tail: RunStatsTail, output_dir: Path) -> bool:
+        """True once the run has plateaued; self.point then says where"""
+        if self.point is not None:
+            return True
+        latest = tail.latest()
+        if "WallTime" not in latest:
+            return False
+        wall = latest["WallTime"] / 1e6
+        covered = latest.get("CoveredInstructions", 0)
+        tests = len(list(Path(output_dir).glob("test*.ktest")))
+        if covered > self.covered or tests > self.tests:
+            self.covered, self.tests, self.progress_at = covered, tests, wall
+        elif wall - self.progress_at >= self.seconds:
+            self.point = {"plateau_seconds": self.seconds,
+                          "last_progress_wall_s": round(self.progress_at, 3),
+                          "stopped_wall_s": round(wall, 3),
+                          "covered_instructions": covered,
+                          "tests": tests}
+            return True
+        return False
+
+    def record(self, output_dir: Path) -> None:
+        """Write the plateau point next to KLEE's own stats"""
+        with open(Path(output_dir) / "plateau.json", "w") as f:
+            json.dump(self.point, f, indent=2)
+
+
+def read_plateau(output_dir: Path) -> Optional[Dict]:
+    """Plateau point of a run stopped by PlateauRule, None if it ran out its time"""
+    try:
+        with open(Path(output_dir) / "plateau.json") as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+
+def format_row(row: Dict[str, float]) -> str:
+    """One-line progress of a run from its latest stats row"""
+    if not row:
+        return "no stats yet"
+    covered = row.get("CoveredInstructions", 0)
+    total = covered + row.get("UncoveredInstructions", 0)
+    cov = f"{100.0 * covered / total:.1f}%" if total else "n/a"
+    return (f"{row.get('WallTime', 0) / 1e6:.0f}s cov {cov} "
+            f"queries {row.get('NumQueries', 0)} solver {row.get('SolverTime', 0) / 1e6:.1f}s "
+            f"states {row.get('NumStates', 0)}")
+
+
+if __name__ == "__main__":
+    # Follow a running KLEE: klee_stats.py OUTPUT_DIR
+    if len(sys.argv) != 2:
+        print(f"Usage: {sys.argv[0]} KLEE_OUTPUT_DIR")
+        sys.exit(1)
+    tail = RunStatsTail(Path(sys.argv[1]))
+    try:
+        while True:
+            if tail.poll():
+                print(format_row(tail.latest()), flush=True)
+            time.sleep(1.0)
+    except KeyboardInterrupt:
+        pass
@@ -66,33 +66,35 @@ case "$UTILITY" in
     ;;
 esac
 
-echo "[INFO] Running $UTILITY tests from $TEST_DIR"
-for t in "$TEST_DIR"/*.sh; do
+# Runs one test script, its records going to $2
+run_test() {
+  local t="$1" log="$2" base
   base=$(basename "$t")
 
   # Skip privileged tests if TEST_FILTER is set
   if [[ -n "${TEST_FILTER:-}" ]]; then
     if ! echo "$base" | grep -qE "$TEST_FILTER"; then
       echo "[SKIP] $t (requires privileges)"
-      continue
+      return 0
     fi
   fi
 
   # Decide srcdir heuristic (matches upstream tests' expectation)
+  local SRC
   case "$(sed -n '1,20p' "$t")" in
     *'/tests/init.sh'*) SRC='.' ;;
     *)                  SRC='tests' ;;
   esac
 
   # Utility-specific knobs (extend as needed)
-  EXTRA_ENV=()
+  local EXTRA_ENV=()
   case "$UTILITY" in
     rm) EXTRA_ENV+=(RM_OPT='-f');;
     *)  ;;
   esac
 
   echo "[RUN] $t (srcdir=$SRC)"
-  if ! VASE_LOG="$VASE_LOG" \
+  if ! VASE_LOG="$log" \
        built_programs=" $UTILITY " \
        srcdir="$SRC" \
        VERBOSE=yes \
@@ -104,8 +106,42 @@ for t in "$TEST_DIR"/*.sh; do
     fi
   fi
   echo "[DONE] $t"
+}
+
+# VASE_TEST_JOBS=N runs up to N test scripts at once, each logging to its own
+# shard; the shards are appended to $VASE_LOG in test order at the end.
+# VASE_TEST_LOGS=DIR keeps the shards there, one per test (for
+# tools/analyzer/minimize_tests.py); VASE_TEST_SUBSET=FILE runs only the
+# tests named in FILE, one per line.
+JOBS="${VASE_TEST_JOBS:-1}"
+TESTS=()
+for t in "$TEST_DIR"/*.sh; do
+  if [[ -n "${VASE_TEST_SUBSET:-}" ]] && ! grep -qxF "$(basename "$t")" "$VASE_TEST_SUBSET"; then
+    continue
+  fi
+  TESTS+=("$t")
 done
 
+echo "[INFO] Running ${#TESTS[@]} $UTILITY tests from $TEST_DIR (jobs: $JOBS)"
+if (( JOBS <= 1 )) && [[ -z "${VASE_TEST_LOGS:-}" ]]; then
+  for t in "${TESTS[@]}"; do
+    run_test "$t" "$VASE_LOG"
+  done
+else
+  SHARD_DIR="${VASE_TEST_LOGS:-$VASE_DIR/log-shards}"
+  rm -rf "$SHARD_DIR"; mkdir -p "$SHARD_DIR"
+  for t in "${TESTS[@]}"; do
+    while (( $(jobs -rp | wc -l) >= JOBS )); do wait -n || true; done
+    run_test "$t" "$SHARD_DIR/$(basename "$t").txt" &
+  done
+  wait
+  for t in "${TESTS[@]}"; do
+    shard="$SHARD_DIR/$(basename "$t").txt"
+    if [[ -f "$shard" ]]; then cat "$shard" >> "$VASE_LOG"; else : > "$shard"; fi
+  done
+  if [[ -z "${VASE_TEST_LOGS:-}" ]]; then rm -rf "$SHARD_DIR"; fi
+fi
+
 # Summary
 echo "---- VASE value log (per-run) ----"
 ls -lh "$VASE_LOG" || true
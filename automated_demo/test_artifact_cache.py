@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Tests of the phase-output cache (artifact_cache.py): keys by input content
+and parameters, and storing and fetching entries
+
+Usage:
+    python3 test_artifact_cache.py
+"""
+
+import os
+import sys
+import tempfile
+from pathlib import Path
+
+from artifact_cache import ArtifactCache, InputHasher, sha256_file
+
+
+def test_keys():
+    """Keys change with input content and parameters, not with file paths"""
+    print("🧪 Keys")
+    with tempfile.TemporaryDirectory() as tmp:
+        tmp = Path(tmp)
+        (tmp / "a").mkdir()
+        (tmp / "b").mkdir()
+        bc = tmp / "a" / "prog.bc"
+        bc.write_bytes(b"bitcode v1")
+        copy = tmp / "b" / "prog.bc"
+        copy.write_bytes(b"bitcode v1")
+
+        key = InputHasher().key("phase1", {"bc": bc, "libc_calls": False})
+        assert InputHasher().key("phase1", {"bc": bc, "libc_calls": False}) == key, \
+            "same inputs, different keys"
+        assert InputHasher().key("phase1", {"bc": copy, "libc_calls": False}) == key, \
+            "same content elsewhere, different key"
+        assert InputHasher().key("phase1", {"bc": bc, "libc_calls": True}) != key, \
+            "parameter change kept the key"
+        assert InputHasher().key("phase2", {"bc": bc, "libc_calls": False}) != key, \
+            "phase name not part of the key"
+
+        hasher = InputHasher()
+        hasher.key("phase1", {"bc": bc})
+        bc.write_bytes(b"bitcode v2")
+        os.utime(bc, ns=(bc.stat().st_atime_ns, bc.stat().st_mtime_ns + 10**9))
+        # The hasher's memo is invalidated by size and mtime
+        assert hasher.key("phase1", {"bc": bc, "libc_calls": False}) != key, \
+            "content change kept the key"
+
+        # A directory input stands for every file under it
+        tree = InputHasher().digest(tmp / "a")
+        (tmp / "a" / "extra").write_text("x")
+        assert InputHasher().digest(tmp / "a") != tree, "directory digest ignores a new file"
+        assert InputHasher().digest(tmp / "missing") is None, "missing file has a digest"
+    print("✅ Keys as expected")
+
+
+def test_sidecar():
+    """A <file>.sha256 newer than the file is trusted, an older one is not"""
+    print("🧪 Digest sidecar")
+    with tempfile.TemporaryDirectory() as tmp:
+        bc = Path(tmp) / "frozen.bc"
+        bc.write_bytes(b"frozen bitcode")
+        sidecar = Path(f"{bc}.sha256")
+        sidecar.write_text("feedface  frozen.bc\n")
+        st = bc.stat()
+        os.utime(sidecar, ns=(st.st_atime_ns, st.st_mtime_ns + 10**9))
+        assert InputHasher().digest(bc) == "feedface", "sidecar not used"
+        os.utime(sidecar, ns=(st.st_atime_ns, st.st_mtime_ns - 10**9))
+        assert InputHasher().digest(bc) == sha256_file(bc), "stale sidecar used"
+    print("✅ Sidecar handled")
+
+
+def test_store_fetch():
+    """Files and directories round-trip; an entry is stored once"""
+    print("🧪 Store and fetch")
+    with tempfile.TemporaryDirectory() as tmp:
+        tmp = Path(tmp)
+        cache = ArtifactCache(tmp / "cache")
+        src, dest = tmp / "src", tmp / "dest"
+        src.mkdir()
+        dest.mkdir()
+        (src / "map.json").write_text("{}")
+        (src / "klee-out").mkdir()
+        (src / "klee-out" / "info").write_text("done")
+
+        key = cache.key("phase2", {"map": src / "map.json"})
+        assert not cache.fetch(key, dest), "fetch of an empty cache hit"
+        assert cache.store(key, "phase2", src, ["map.json", "klee-out", "absent.txt"]), \
+            "store failed"
+        assert not cache.store(key, "phase2", src, ["map.json"]), "same key stored twice"
+        assert cache.manifest(key)["files"] == ["map.json", "klee-out"], \
+            f"manifest: {cache.manifest(key)}"
+
+        # Fetching replaces what is in the way
+        (dest / "klee-out").mkdir()
+        (dest / "klee-out" / "stale").write_text("old")
+        (dest / "map.json").write_text("old")
+        assert cache.fetch(key, dest), "fetch missed a stored entry"
+        assert (dest / "map.json").read_text() == "{}" and \
+            (dest / "klee-out" / "info").read_text() == "done" and \
+            not (dest / "klee-out" / "stale").exists(), \
+            "fetched files differ from the stored ones"
+
+        # A cache opened again (next run) finds the entry
+        assert ArtifactCache(tmp / "cache").fetch(key, dest), \
+            "entry not found by a new cache instance"
+        # No temporary directories left behind
+        leftovers = [p for p in cache.entry_dir(key).parent.iterdir() if p.name.startswith(".")]
+        assert not leftovers, f"leftover temporary entries: {leftovers}"
+    print("✅ Store and fetch round-trip")
+
+
+TESTS = [
+    ("Keys", test_keys),
+    ("Sidecar", test_sidecar),
+    ("Store and fetch", test_store_fetch),
+]
+
+
+def main():
+    """Run all artifact cache tests"""
+    print("=" * 60)
+    print("EVP Artifact Cache Tests")
+    print("=" * 60)
+
+    results = {}
+    for name, test in TESTS:
+        try:
+            test()
+            results[name] = "PASSED"
+        except AssertionError as e:
+            print(f"❌ {e}")
+            results[name] = "FAILED"
+
+    print("\n" + "=" * 60)
+    print("Test Summary:")
+    for name, status in results.items():
+        print(f"{name}: {status}")
+    print("=" * 60)
+
+    return "FAILED" not in results.values()
+
+
+if __name__ == "__main__":
+    success = main()
+    sys.exit(0 if success else 1)
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""
+Tests of klee_scheduler.py: admission against the memory budget, groups
+starting together, and the queue file across restarts (requeue, resubmit)
+
+Jobs are short Python sleeps standing in for KLEE; their commands carry the
+--max-memory and --output-dir flags the scheduler reads.
+
+Usage:
+    python3 test_klee_scheduler.py
+"""
+
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+import klee_scheduler
+from klee_scheduler import KLEEScheduler
+
+
+def fake_meminfo(available_mb):
+    return lambda: {"MemTotal": 64000, "MemAvailable": available_mb}
+
+
+def klee_cmd(out, max_memory, seconds=0.3):
+    return [sys.executable, "-c", f"import time; time.sleep({seconds})",
+            f"--max-memory={max_memory}", f"--output-dir={out}"]
+
+
+def submit(sched, tmp, job_id, group, max_memory, program="prog", arm="evp"):
+    out = tmp / "out" / job_id
+    return sched.submit(job_id, group, program, arm, klee_cmd(out, max_memory),
+                        out, tmp / "sandbox" / job_id)
+
+
+def new_scheduler(tmp, memory_mb, cores=None):
+    cores = cores or set(sorted(os.sched_getaffinity(0))[:2])
+    sched = KLEEScheduler(tmp / "queue.json", cores=cores, memory_mb=memory_mb, reserve_mb=500)
+    sched.POLL_SECONDS = 0.05
+    return sched
+
+
+def test_admission():
+    """Groups start whole and only while their estimates fit the budget"""
+    print("🧪 Admission")
+    saved = klee_scheduler.read_meminfo, os.sched_setaffinity
+    klee_scheduler.read_meminfo = fake_meminfo(100000)
+    # Four cores on any machine, so that only memory holds runs back;
+    # pinning to them is a no-op in the (forked) children
+    os.sched_setaffinity = lambda pid, cpus: None
+    try:
+        with tempfile.TemporaryDirectory() as tmp:
+            tmp = Path(tmp)
+            sched = new_scheduler(tmp, memory_mb=3000, cores={0, 1, 2, 3})
+            submit(sched, tmp, "ls-vanilla", "ls", 1000, arm="vanilla")
+            submit(sched, tmp, "ls-evp", "ls", 1000)
+            submit(sched, tmp, "cat-evp", "cat", 1500)
+
+            sched.admit()
+            status = {j["id"]: j["status"] for j in sched.jobs}
+            assert status == {"ls-vanilla": "running", "ls-evp": "running", "cat-evp": "pending"}, \
+                f"after first admission: {status}"
+            assert sorted(sched.job(i)["cpu"] for i in ("ls-vanilla", "ls-evp")) == [0, 1], \
+                "arms of a group not on cores of their own"
+            assert sched.committed_mb() == 2000, f"committed {sched.committed_mb()} MB, expected 2000"
+
+            sched.run()
+            assert all(j["status"] == "done" for j in sched.jobs), \
+                f"not all jobs done: {[(j['id'], j['status']) for j in sched.jobs]}"
+            # cat-evp could only start once both ls arms had finished
+            ls_end = max(sched.job(i)["finished"] for i in ("ls-vanilla", "ls-evp"))
+            assert sched.job("cat-evp")["started"] >= ls_end, \
+                "cat-evp started beside the ls group, over budget"
+
+            # MemAvailable below the reserve holds a group back too
+            klee_scheduler.read_meminfo = fake_meminfo(1200)
+            submit(sched, tmp, "cp-evp", "cp", 1000)
+            submit(sched, tmp, "mv-evp", "mv", 1000)
+            sched.admit()
+            running = [j["id"] for j in sched.jobs if j["status"] == "running"]
+            # Idle: the first group runs although it does not fit, alone
+            assert running == ["cp-evp"], f"running under low MemAvailable: {running}"
+            sched.run()
+    finally:
+        klee_scheduler.read_meminfo, os.sched_setaffinity = saved
+    print("✅ Admission within the budget")
+
+
+def test_requeue():
+    """Runs left "running" by a dead scheduler are killed and requeued"""
+    print("🧪 Requeue after restart")
+    with tempfile.TemporaryDirectory() as tmp:
+        tmp = Path(tmp)
+        out = tmp / "out" / "ls-evp"
+        stale = subprocess.Popen(klee_cmd(out, 1000, seconds=60), start_new_session=True)
+        try:
+            # Until it has exec'd, the child's cmdline is still this script's
+            while f"--output-dir={out}".encode() not in Path(f"/proc/{stale.pid}/cmdline").read_bytes():
+                time.sleep(0.01)
+            sched = new_scheduler(tmp, memory_mb=8000)
+            job = submit(sched, tmp, "ls-evp", "ls", 1000)
+            other = submit(sched, tmp, "cat-evp", "cat", 1000)
+            # As a scheduler killed mid-run leaves the queue file
+            job.update(status="running", pid=stale.pid, cpu=0)
+            # A recycled pid: not this job's process, must survive
+            other.update(status="running", pid=os.getpid(), cpu=1)
+            sched.save()
+
+            restarted = new_scheduler(tmp, memory_mb=8000)
+            try:
+                stale.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                raise AssertionError("stale run not killed")
+            status = {j["id"]: j["status"] for j in restarted.jobs}
+            assert status == {"ls-evp": "pending", "cat-evp": "pending"}, f"after restart: {status}"
+            with open(tmp / "queue.json") as f:
+                assert all(j["status"] == "pending" for j in json.load(f)["jobs"]), \
+                    "requeue not saved to the queue file"
+        finally:
+            if stale.poll() is None:
+                stale.kill()
+    print("✅ Interrupted runs requeued")
+
+
+def test_resubmit():
+    """Resubmission keeps finished runs with output, redoes the others"""
+    print("🧪 Resubmit and drop")
+    with tempfile.TemporaryDirectory() as tmp:
+        tmp = Path(tmp)
+        sched = new_scheduler(tmp, memory_mb=8000)
+        kept = submit(sched, tmp, "ls-evp", "ls", 1000)
+        lost = submit(sched, tmp, "cat-evp", "cat", 1000)
+        for job in (kept, lost):
+            job.update(status="done", exit_code=0, finished=time.time())
+        Path(kept["output_dir"]).mkdir(parents=True)
+        sched.save()
+
+        sched = new_scheduler(tmp, memory_mb=8000)
+        assert submit(sched, tmp, "ls-evp", "ls", 1000)["status"] == "done", \
+            "finished run with output not kept"
+        assert submit(sched, tmp, "cat-evp", "cat", 1000)["status"] == "pending", \
+            "finished run without output not requeued"
+        assert len(sched.jobs) == 2, "resubmission duplicated a job"
+
+        submit(sched, tmp, "cp-evp", "cp", 1000)
+        sched.drop_pending({"ls-evp", "cp-evp"})
+        assert [j["id"] for j in sched.jobs] == ["ls-evp", "cp-evp"], \
+            f"drop_pending left {[j['id'] for j in sched.jobs]}"
+    print("✅ Resubmission deduplicated")
+
+
+TESTS = [
+    ("Admission", test_admission),
+    ("Requeue", test_requeue),
+    ("Resubmit", test_resubmit),
+]
+
+
+def main():
+    """Run all scheduler tests"""
+    print("=" * 60)
+    print("KLEE Scheduler Tests")
+    print("=" * 60)
+
+    results = {}
+    for name, test in TESTS:
+        try:
+            test()
+            results[name] = "PASSED"
+        except AssertionError as e:
+            print(f"❌ {e}")
+            results[name] = "FAILED"
+
+    print("\n" + "=" * 60)
+    print("Test Summary:")
+    for name, status in results.items():
+        print(f"{name}: {status}")
+    print("=" * 60)
+
+    return "FAILED" not in results.values()
+
+
+if __name__ == "__main__":
+    success = main()
+    sys.exit(0 if success else 1)
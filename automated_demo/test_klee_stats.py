@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+Tests of klee_stats.py: following run.stats in both formats while it grows,
+and the coverage plateau rule
+
+Usage:
+    python3 test_klee_stats.py
+"""
+
+import sqlite3
+import sys
+import tempfile
+from pathlib import Path
+
+from klee_stats import PlateauRule, RunStatsTail, read_plateau
+
+COLUMNS = ["Instructions", "CoveredInstructions", "WallTime", "SolverTime"]
+
+
+def test_sqlite():
+    """KLEE 2.x run.stats: only rows added since the last poll are returned"""
+    print("🧪 run.stats, SQLite")
+    with tempfile.TemporaryDirectory() as tmp:
+        tail = RunStatsTail(Path(tmp))
+        assert tail.poll() == [], "rows before run.stats exists"
+        db = sqlite3.connect(Path(tmp) / "run.stats")
+        db.execute("CREATE TABLE stats (" + ", ".join(f"{c} INTEGER" for c in COLUMNS) + ")")
+        db.execute("INSERT INTO stats VALUES (100, 10, 1000000, 200)")
+        db.commit()
+        first = tail.poll()
+        db.execute("INSERT INTO stats VALUES (200, 15, 2000000, 300)")
+        db.execute("INSERT INTO stats VALUES (300, 18, 3000000, 400)")
+        db.commit()
+        second = tail.poll()
+        third = tail.poll()
+        db.close()
+
+    assert first == [dict(zip(COLUMNS, [100, 10, 1000000, 200]))], f"first poll: {first}"
+    assert [r["Instructions"] for r in second] == [200, 300] and third == [], \
+        f"later polls: {second} {third}"
+    assert tail.rows == 3 and tail.latest()["CoveredInstructions"] == 18 and \
+        tail.summary()["WallTime"] == [1000000, 2000000, 3000000], f"series: {tail.series}"
+    print("✅ SQLite rows read incrementally")
+
+
+def test_text():
+    """Older text run.stats: complete lines only, times converted to µs"""
+    print("🧪 run.stats, text")
+    with tempfile.TemporaryDirectory() as tmp:
+        path = Path(tmp) / "run.stats"
+        tail = RunStatsTail(Path(tmp))
+        with open(path, "w") as f:
+            f.write("('Instructions','CoveredInstructions','WallTime','SolverTime')\n")
+            f.write("(100,10,1.5,0.25)\n")
+            f.write("(200,15,2.")        # KLEE still writing this line
+        first = tail.poll()
+        with open(path, "a") as f:
+            f.write("5,0.5)\n")
+        second = tail.poll()
+
+    assert first == [{"Instructions": 100, "CoveredInstructions": 10,
+                      "WallTime": 1500000, "SolverTime": 250000}], f"first poll: {first}"
+    assert second == [{"Instructions": 200, "CoveredInstructions": 15,
+                       "WallTime": 2500000, "SolverTime": 500000}], \
+        f"partial line not completed on the next poll: {second}"
+    print("✅ Text rows read incrementally")
+
+
+class Rows:
+    """Stand-in for RunStatsTail: a latest row set by the test"""
+
+    def __init__(self):
+        self.row = {}
+
+    def latest(self):
+        return self.row
+
+
+def test_plateau():
+    """Coverage or tests reset the clock; `seconds` without either plateau"""
+    print("🧪 Plateau rule")
+    with tempfile.TemporaryDirectory() as tmp:
+        out = Path(tmp)
+        rule, rows = PlateauRule(10), Rows()
+        assert not rule.update(rows, out), "plateau before any stats"
+        steps = [
+            (0, 10, False),
+            (5, 20, False),    # new coverage at 5s
+            (14, 20, False),
+            (14.5, 20, None),  # new test at 14.5s
+            (24, 20, False),
+            (24.5, 20, True),  # 10s after the test
+        ]
+        for wall, covered, expected in steps:
+            if expected is None:
+                (out / "test000001.ktest").write_bytes(b"")
+                expected = False
+            rows.row = {"WallTime": int(wall * 1e6), "CoveredInstructions": covered}
+            assert rule.update(rows, out) == expected, \
+                f"at {wall}s: expected {'plateau' if expected else 'progress'}"
+        assert rule.point == {"plateau_seconds": 10, "last_progress_wall_s": 14.5,
+                              "stopped_wall_s": 24.5, "covered_instructions": 20,
+                              "tests": 1}, f"plateau point: {rule.point}"
+        assert read_plateau(out) is None, "plateau read before it was recorded"
+        rule.record(out)
+        assert read_plateau(out) == rule.point, f"recorded plateau: {read_plateau(out)}"
+    print("✅ Plateau detected and recorded")
+
+
+TESTS = [
+    ("SQLite run.stats", test_sqlite),
+    ("Text run.stats", test_text),
+    ("Plateau rule", test_plateau),
+]
+
+
+def main():
+    """Run all KLEE stats tests"""
+    print("=" * 60)
+    print("KLEE Stats Tests")
+    print("=" * 60)
+
+    results = {}
+    for name, test in TESTS:
+        try:
+            test()
+            results[name] = "PASSED"
+        except AssertionError as e:
+            print(f"❌ {e}")
+            results[name] = "FAILED"
+
+    print("\n" + "=" * 60)
+    print("Test Summary:")
+    for name, status in results.items():
+        print(f"{name}: {status}")
+    print("=" * 60)
+
+    return "FAILED" not in results.values()
+
+
+if __name__ == "__main__":
+    success = main()
+    sys.exit(0 if success else 1)
@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+Tests of the map files VaseSolver loads (--vase-map, --vase-lib-map)
+
+The loader itself needs a KLEE build; these check what it relies on: the
+JSON map of both generators (derived [] vars, 64-bit input values), the
+VASEMAP2 binary map of vase-mapgen against its JSON, and the contents of a
+library map (build_lib_map.py).
+
+Usage:
+    python3 test_map_files.py
+"""
+
+import json
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+from collections import Counter
+from pathlib import Path
+
+TOOLS = Path(__file__).parent / "tools"
+GENERATOR = TOOLS / "analyzer" / "generate_limited_map.py"
+LIB_MAP = TOOLS / "analyzer" / "build_lib_map.py"
+MAPGEN = TOOLS / "mapgen" / "vase-mapgen"
+
+LOG = ("loc:7:branch:0\tx:1\n" * 2 +
+       "loc:7:branch:1\tx:2\n" * 2 +
+       "loc:7:branch:1\tx:3\n" +
+       "loc:9\ty:4\n" * 2 +
+       "loc:7:input:stdin:0:8\tx:4294967297\n" * 2)
+
+
+def generate(generator, log, out, *extra):
+    cmd = generator + ["--log", str(log), "--out", str(out),
+                       "--max-values", "4", "--min-occurrence", "2"] + list(extra)
+    result = subprocess.run(cmd, capture_output=True, text=True)
+    assert result.returncode == 0, f"{generator[-1]} failed:\n{result.stderr}"
+
+
+def read_binary_map(data):
+    """Entries of a VASEMAP2 file, as VaseSolver reads them; None if malformed"""
+    if data[:8] != b"VASEMAP2":
+        return None
+    pos = 8
+
+    def u32():
+        nonlocal pos
+        if pos + 4 > len(data):
+            raise ValueError("truncated")
+        pos += 4
+        return struct.unpack_from("<I", data, pos - 4)[0]
+
+    def string():
+        nonlocal pos
+        n = u32()
+        if n > len(data) - pos:
+            raise ValueError("length beyond end of file")
+        pos += n
+        return data[pos - n:pos].decode()
+
+    try:
+        entries = {}
+        for _ in range(u32()):
+            key, var_map = string(), {}
+            for _ in range(u32()):
+                var, values = string(), []
+                for _ in range(u32()):
+                    kind, value = u32(), string()
+                    weight = u32() | (u32() << 32)
+                    values.append({"type": kind, "value": value, "weight": weight})
+                var_map[var] = values
+            entries[key] = var_map
+        return entries
+    except ValueError:
+        return None
+
+
+def test_json_map():
+    """Derived [] vars and 64-bit input values in the analyzer's JSON map"""
+    print("🧪 JSON map (generate_limited_map.py)")
+    with tempfile.TemporaryDirectory() as tmp:
+        log, out = Path(tmp) / "log.txt", Path(tmp) / "map.json"
+        log.write_text(LOG)
+        generate([sys.executable, str(GENERATOR)], log, out)
+        entries = json.loads(out.read_text())
+
+    # loc:7 equals the union of its branches, so it is written as []
+    assert entries.get("loc:7") == {"x": []}, f"loc:7 not derived: {entries.get('loc:7')}"
+    union = Counter()
+    for key in ("loc:7:branch:0", "loc:7:branch:1"):
+        for e in entries[key]["x"]:
+            union[e["value"]] += e["weight"]
+    assert union == Counter({"1": 2, "2": 2, "3": 1}), \
+        f"branch lists do not add up to the profile: {dict(union)}"
+    # No branches: written in full
+    assert entries.get("loc:9") == {"y": [{"type": 0, "value": "4", "weight": 2}]}, \
+        f"loc:9: {entries.get('loc:9')}"
+    # An 8-byte input load keeps all 64 bits
+    assert entries.get("loc:7:arr:stdin:0:8", {}).get("x", [{}])[0].get("value") == "4294967297", \
+        f"loc:7:arr:stdin:0:8: {entries.get('loc:7:arr:stdin:0:8')}"
+    print("✅ JSON map as expected")
+
+
+def test_binary_map():
+    """vase-mapgen: same JSON as the analyzer, and a binary map with the same entries"""
+    print("🧪 Binary map (vase-mapgen --binary-out)")
+    if not MAPGEN.exists():
+        raise unittest.SkipTest(f"{MAPGEN} not built (tools/mapgen/build.sh)")
+    with tempfile.TemporaryDirectory() as tmp:
+        tmp = Path(tmp)
+        log = tmp / "log.txt"
+        log.write_text(LOG)
+        generate([sys.executable, str(GENERATOR)], log, tmp / "py.json")
+        generate([str(MAPGEN)], log, tmp / "native.json", "--binary-out", str(tmp / "map.bin"))
+        assert (tmp / "py.json").read_bytes() == (tmp / "native.json").read_bytes(), \
+            "vase-mapgen JSON differs from generate_limited_map.py"
+        expected = json.loads((tmp / "native.json").read_text())
+        data = (tmp / "map.bin").read_bytes()
+
+    binary = read_binary_map(data)
+    assert binary == expected, f"binary map differs from JSON map: {binary}"
+    # A string length past the end of the file makes the map unreadable
+    corrupt = bytearray(data)
+    struct.pack_into("<I", corrupt, 12, 0xfffffff0)
+    assert read_binary_map(bytes(corrupt)) is None, "corrupt length accepted"
+    print("✅ Binary map matches JSON map")
+
+
+def write_program(prog_dir, functions, log):
+    prog_dir.mkdir()
+    with open(prog_dir / "siteManifest.json", "w") as f:
+        json.dump({"site_ids": "stable", "functions": functions}, f)
+    (prog_dir / "vase_value_log.txt").write_text(log)
+
+
+def test_lib_map():
+    """Library map: shared library sites only, not ambiguous or program sites"""
+    print("🧪 Library map (build_lib_map.py)")
+    shared = {"hash": "0000abcd", "file": "lib/quotearg.c", "instrumented": True, "sites": [100]}
+    log = ("loc:100\tc:10\n" * 2 + "loc:200\td:20\n" * 2 + "loc:300\te:30\n" * 2 +
+           "loc:100:input:stdin:0:1\tc:10\n" * 2)
+    with tempfile.TemporaryDirectory() as tmp:
+        tmp = Path(tmp)
+        write_program(tmp / "ls", {
+            "quotearg": shared,
+            "xstrtol": {"hash": "00001111", "file": "lib/xstrtol.c", "instrumented": True, "sites": [200]},
+            "main": {"hash": "00002222", "file": "src/ls.c", "instrumented": True, "sites": [300]}
+        }, log)
+        write_program(tmp / "cat", {
+            "quotearg": shared,
+            # Same site id, different code: ambiguous
+            "xstrtol": {"hash": "00003333", "file": "lib/xstrtol.c", "instrumented": True, "sites": [200]}
+        }, log)
+        out = tmp / "libMap.json"
+        result = subprocess.run([sys.executable, str(LIB_MAP), str(tmp / "ls"), str(tmp / "cat"),
+                                 "--out", str(out), "--min-occurrence", "2"],
+                                capture_output=True, text=True)
+        assert result.returncode == 0 and out.exists(), \
+            f"build_lib_map.py failed: {result.stdout}{result.stderr}"
+        entries = json.loads(out.read_text())
+
+    assert set(entries) == {"loc:100"}, f"expected only loc:100, got {sorted(entries)}"
+    # Records of both programs count
+    assert entries["loc:100"] == {"c": [{"type": 0, "value": "10", "weight": 4}]}, \
+        f"loc:100: {entries['loc:100']}"
+    print("✅ Library map has the shared site only")
+
+
+TESTS = [
+    ("JSON map", test_json_map),
+    ("Binary map", test_binary_map),
+    ("Library map", test_lib_map),
+]
+
+
+def main():
+    """Run all map file tests"""
+    print("=" * 60)
+    print("VASE Map File Tests")
+    print("=" * 60)
+
+    results = {}
+    for name, test in TESTS:
+        try:
+            test()
+            results[name] = "PASSED"
+        except unittest.SkipTest as e:
+            print(f"[SKIP] {e}")
+            results[name] = "SKIPPED"
+        except AssertionError as e:
+            print(f"❌ {e}")
+            results[name] = "FAILED"
+
+    print("\n" + "=" * 60)
+    print("Test Summary:")
+    for name, status in results.items():
+        print(f"{name}: {status}")
+    print("=" * 60)
+
+    return "FAILED" not in results.values()
+
+
+if __name__ == "__main__":
+    success = main()
+    sys.exit(0 if success else 1)
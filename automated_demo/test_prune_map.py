@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Tests of prune_map.py: per-site decisions from phase-3 site stats, and how
+drop and demote decisions rewrite a map (derived [] vars included)
+
+Usage:
+    python3 test_prune_map.py
+"""
+
+import argparse
+import sys
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).parent / "tools" / "analyzer"))
+import prune_map
+
+
+def value(v, weight):
+    return {"type": 0, "value": v, "weight": weight}
+
+
+def sample_map():
+    return {
+        "loc:7:branch:0": {"x": [value("1", 2)]},
+        "loc:7:branch:1": {"x": [value("2", 2), value("3", 1)]},
+        "loc:7": {"x": []},
+        "loc:9": {"y": [value("4", 3), value("5", 1)]},
+        "loc:11": {"z": [value("6", 2), value("7", 1)]},
+    }
+
+
+def test_decide():
+    """Drop, demote, or keep a site from its stats"""
+    print("🧪 Site decisions")
+    args = argparse.Namespace(min_saving_us=0.0, min_trials=20)
+    base = {"queries": 10, "solver_us": 1000}
+    cases = [
+        # (evp stats, baseline, previous decision, expected)
+        ({"trials": 0, "queries": 5, "solver_us": 9000}, base, None, None),
+        ({"trials": 5, "rewritten": 2, "queries": 10, "solver_us": 500}, base, None, None),
+        ({"trials": 5, "rewritten": 2, "queries": 10, "solver_us": 2000}, base, None, "demote"),
+        ({"trials": 5, "rewritten": 2, "queries": 10, "solver_us": 2000}, base, "demote", "drop"),
+        ({"trials": 5, "rewritten": 0, "queries": 10, "solver_us": 2000}, base, None, "drop"),
+        # Without a baseline: only sites that never rewrote in min_trials
+        ({"trials": 19, "rewritten": 0, "queries": 10, "solver_us": 1}, None, None, None),
+        ({"trials": 20, "rewritten": 0, "queries": 10, "solver_us": 1}, None, None, "drop"),
+        ({"trials": 50, "rewritten": 1, "queries": 10, "solver_us": 1}, None, None, None),
+    ]
+    for evp, baseline, previous, expected in cases:
+        got = prune_map.decide(evp, baseline, previous, args)
+        assert got == expected, f"decide({evp}, previous={previous}) = {got}, expected {expected}"
+    print("✅ Decisions as expected")
+
+
+def test_drop():
+    """A dropped site loses all its keys, other sites are untouched"""
+    print("🧪 Drop")
+    output = sample_map()
+    dropped, demoted = prune_map.apply(output, {"loc:7": "drop"})
+    assert (dropped, demoted) == (3, 0) and set(output) == {"loc:9", "loc:11"}, \
+        f"got {dropped} dropped, {demoted} demoted: {sorted(output)}"
+    assert output["loc:11"] == sample_map()["loc:11"], "undecided site changed"
+    print("✅ Site dropped")
+
+
+def test_demote():
+    """A demoted site keeps its most frequent value, derived [] vars too"""
+    print("🧪 Demote")
+    output = sample_map()
+    dropped, demoted = prune_map.apply(output, {"loc:7": "demote", "loc:9": "drop"})
+    assert (dropped, demoted) == (1, 3), f"got {dropped} dropped, {demoted} demoted"
+    expected = {
+        "loc:7:branch:0": {"x": [value("1", 2)]},
+        "loc:7:branch:1": {"x": [value("2", 2)]},
+        # Derived from the branches before they were demoted: 1 and 2 tie
+        # at weight 2, numeric order decides
+        "loc:7": {"x": [value("1", 2)]},
+        "loc:11": sample_map()["loc:11"],
+    }
+    assert output == expected, f"demoted map: {output}"
+    # Reapplying the same decisions changes nothing
+    again = prune_map.apply(output, {"loc:7": "demote", "loc:9": "drop"})
+    assert output == expected and again == (0, 3), f"reapplied decisions changed the map: {output}"
+    print("✅ Site demoted")
+
+
+def test_derive():
+    """A derived list is the branch lists merged, as VaseSolver derives it"""
+    print("🧪 Derived lists")
+    derived = prune_map.derive(sample_map(), "loc:7", "x")
+    assert derived == [value("1", 2), value("2", 2), value("3", 1)], f"derive: {derived}"
+    # Numeric, not string, order among equal weights
+    output = {"loc:3:branch:0": {"v": [value("10", 1)]},
+              "loc:3:branch:1": {"v": [value("9", 1)]}}
+    assert [e["value"] for e in prune_map.derive(output, "loc:3", "v")] == ["9", "10"], \
+        "ties not in numeric order"
+    print("✅ Derived lists as expected")
+
+
+TESTS = [
+    ("Decisions", test_decide),
+    ("Drop", test_drop),
+    ("Demote", test_demote),
+    ("Derive", test_derive),
+]
+
+
+def main():
+    """Run all prune_map tests"""
+    print("=" * 60)
+    print("VASE Map Pruning Tests")
+    print("=" * 60)
+
+    results = {}
+    for name, test in TESTS:
+        try:
+            test()
+            results[name] = "PASSED"
+        except AssertionError as e:
+            print(f"❌ {e}")
+            results[name] = "FAILED"
+
+    print("\n" + "=" * 60)
+    print("Test Summary:")
+    for name, status in results.items():
+        print(f"{name}: {status}")
+    print("=" * 60)
+
+    return "FAILED" not in results.values()
+
+
+if __name__ == "__main__":
+    success = main()
+    sys.exit(0 if success else 1)
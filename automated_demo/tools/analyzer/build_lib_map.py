@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Build one shared map for library (gnulib lib/) sites across programs.
+
+Every coreutils program links the same gnulib objects, but each is profiled
+on its own. With stable site ids (-vase-site-ids=stable), a library function
+that compiles to the same code in two programs has the same structural hash
+and the same site ids in both, so the records its sites logged while testing
+either program describe the same code. This tool takes each program's
+siteManifest.json and vase_value_log.txt, keeps the log records of sites in
+library functions (manifest "file" matching --lib-pattern), and builds a map
+from all of them together. VaseSolver layers it under each program's own map
+(--vase-lib-map).
+
+A site id that belongs to library functions with different hashes in
+different programs (e.g. built with different gnulib config) is ambiguous
+and left out. Calling-context and input-offset records are program-specific
+and also left out.
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+LOC_RE = re.compile(r'^loc:(\d+)(?::|\t)')
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Aggregate library-site profiles of several programs into one VASE map")
+    p.add_argument("prog_dirs", nargs="+",
+                   help="Program artifact directories, each with siteManifest.json and vase_value_log.txt")
+    p.add_argument("--out", default="libMap.json", help="Output map (default: libMap.json)")
+    p.add_argument("--lib-pattern", default=r"(^|/)lib/",
+                   help="Regex on a function's source file marking it as library code (default: gnulib's lib/)")
+    p.add_argument("--max-values", type=int, default=8)
+    p.add_argument("--min-occurrence", type=int, default=3)
+    return p.parse_args()
+
+
+def library_sites(manifest_path, lib_re):
+    """site id -> (function, hash) for the library functions of one manifest."""
+    with open(manifest_path, "r", encoding="utf-8") as f:
+        manifest = json.load(f)
+    if manifest.get("site_ids", "sequential") != "stable":
+        return None
+    sites = {}
+    for name, fn in manifest.get("functions", {}).items():
+        if lib_re.search(fn.get("file", "")):
+            for site in fn.get("sites", []):
+                sites[site] = (name, fn["hash"])
+    return sites
+
+
+def main():
+    args = parse_args()
+    lib_re = re.compile(args.lib_pattern)
+
+    # Pass 1: which library sites mean the same code in every program that has them
+    owners = {}      # site id -> (function, hash)
+    ambiguous = set()
+    programs = []
+    for d in map(Path, args.prog_dirs):
+        manifest, log = d / "siteManifest.json", d / "vase_value_log.txt"
+        if not manifest.exists() or not log.exists():
+            print(f"⚠️  {d}: no siteManifest.json or vase_value_log.txt, skipped")
+            continue
+        sites = library_sites(manifest, lib_re)
+        if sites is None:
+            print(f"⚠️  {d}: site ids are not stable, skipped")
+            continue
+        for site, owner in sites.items():
+            if owners.setdefault(site, owner) != owner:
+                ambiguous.add(site)
+        programs.append((d, log, sites))
+    keep = set(owners) - ambiguous
+    if not programs:
+        print("❌ No program with a stable-id manifest and a value log")
+        return 1
+
+    # Pass 2: the library records of every log, into one
+    out = Path(args.out)
+    fd, combined = tempfile.mkstemp(prefix="libLog.", suffix=".txt", dir=out.parent)
+    kept_lines = 0
+    with os.fdopen(fd, "w", encoding="utf-8") as dst:
+        for d, log, sites in programs:
+            n = 0
+            with open(log, "r", encoding="utf-8", errors="ignore") as src:
+                for line in src:
+                    m = LOC_RE.match(line)
+                    if not m or ":input:" in line.split("\t", 1)[0]:
+                        continue
+                    site = int(m.group(1))
+                    if site in keep and site in sites:
+                        dst.write(line if line.endswith("\n") else line + "\n")
+                        n += 1
+            print(f"   {d.name}: {n} library records")
+            kept_lines += n
+
+    # Same generator choice as phase 2 of evp_pipeline.py
+    here = Path(__file__).resolve().parent
+    mapgen = here.parent / "mapgen" / "vase-mapgen"
+    generator = ([str(mapgen)] if os.access(mapgen, os.X_OK)
+                 else [sys.executable, str(here / "generate_limited_map.py")])
+    try:
+        rc = subprocess.call(generator + ["--log", combined, "--out", str(out),
+                                          "--max-values", str(args.max_values),
+                                          "--min-occurrence", str(args.min_occurrence),
+                                          "--no-context", "--no-input-offsets"])
+    finally:
+        os.unlink(combined)
+    if rc != 0:
+        return rc
+
+    functions = {owners[s] for s in keep}
+    print(f"✅ Library map from {len(programs)} programs -> {out}")
+    print(f"   library functions: {len(functions)}, sites: {len(keep)} "
+          f"(ambiguous: {len(ambiguous)}), records: {kept_lines}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
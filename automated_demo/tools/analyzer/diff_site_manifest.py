@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Compare two VASE site manifests (-vase-site-manifest) across a rebuild.
+
+Functions whose structural hash is unchanged keep their site ids, so their
+entries in the old limitedValuedMap.json are still valid. This tool reports
+which functions changed (those are the only ones instrumented when the new
+build is made with -vase-changed-since=OLD) and writes the old map entries of
+unchanged functions to --out-map, for generate_limited_map.py --carry-map.
+"""
+import argparse
+import json
+import re
+
+LOC_RE = re.compile(r'^loc:(\d+)(?::|$)')
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Diff VASE site manifests and carry unchanged map entries forward")
+    p.add_argument("--old", required=True, help="Site manifest of the previous build")
+    p.add_argument("--new", required=True, help="Site manifest of the current build")
+    p.add_argument("--old-map", help="limitedValuedMap.json built from the previous build")
+    p.add_argument("--out-map", help="Write the --old-map entries of unchanged functions here")
+    p.add_argument("--changed-out", help="Write changed/added function names here, one per line")
+    return p.parse_args()
+
+
+def load_functions(path):
+    with open(path, "r", encoding="utf-8") as f:
+        manifest = json.load(f)
+    return manifest.get("site_ids", "sequential"), manifest.get("functions", {})
+
+
+def main():
+    args = parse_args()
+    old_scheme, old_fns = load_functions(args.old)
+    new_scheme, new_fns = load_functions(args.new)
+    if old_scheme != "stable" or new_scheme != "stable":
+        print(f"⚠️  site ids are {old_scheme} -> {new_scheme}; only stable ids can be carried forward")
+
+    unchanged = [n for n, fn in new_fns.items()
+                 if n in old_fns and old_fns[n]["hash"] == fn["hash"]]
+    added = [n for n in new_fns if n not in old_fns]
+    changed = [n for n in new_fns if n in old_fns and n not in unchanged]
+    removed = [n for n in old_fns if n not in new_fns]
+
+    print(f"functions: unchanged={len(unchanged)} changed={len(changed)} added={len(added)} removed={len(removed)}")
+    for n in changed:
+        print(f"   changed  {n}")
+    for n in added:
+        print(f"   added    {n}")
+
+    if args.changed_out:
+        with open(args.changed_out, "w", encoding="utf-8") as out:
+            for n in changed + added:
+                out.write(n + "\n")
+
+    if args.old_map and args.out_map:
+        stable = old_scheme == "stable" and new_scheme == "stable"
+        keep = set()
+        if stable:
+            for n in unchanged:
+                keep.update(new_fns[n].get("sites", []))
+        with open(args.old_map, "r", encoding="utf-8") as f:
+            old_map = json.load(f)
+        carried = {}
+        for key, vars in old_map.items():
+            m = LOC_RE.match(key)
+            if m and int(m.group(1)) in keep:
+                carried[key] = vars
+        with open(args.out_map, "w", encoding="utf-8") as out:
+            json.dump(carried, out, indent=2)
+        print(f"carried {len(carried)}/{len(old_map)} map entries -> {args.out_map}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Pick a small subset of a program's tests that yields the same VASE map.
+
+Takes one value log per test (test-harness-generic.sh with VASE_TEST_LOGS=DIR
+writes DIR/<test>.txt) and greedily picks tests until the subset covers
+every (record key, var, value) the whole suite logged, and every (record
+key, var) that reached --min-occurrence in the suite reaches it in the
+subset too. The map of the subset is then generated and compared with the
+map of the suite, keys and value sets only: weights are observation counts
+and necessarily smaller. While they differ, the unpicked test logging the
+most records of a differing site is added.
+
+The subset is written to --out, one test name per line, for
+test-harness-generic.sh VASE_TEST_SUBSET=FILE.
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+from collections import Counter, defaultdict
+from pathlib import Path
+
+REPEAT_RE = re.compile(r'^#[1-9][0-9]{0,17}$')
+LOC_RE = re.compile(r'^(loc:-?\d+)')
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Greedy minimal test subset preserving the VASE map")
+    p.add_argument("--test-logs", required=True, help="Directory with one value log per test, <test>.txt")
+    p.add_argument("--out", required=True, help="Test subset, one test name per line")
+    p.add_argument("--max-values", type=int, default=8)
+    p.add_argument("--min-occurrence", type=int, default=3)
+    return p.parse_args()
+
+
+def site(key):
+    """loc:N of a map or record key; loc:N:input:ARRAY:OFF:W for input offsets"""
+    loc, sep, rest = key.partition(":arr:")
+    if sep:
+        return f"{loc}:input:{rest}"
+    if ":input:" in key:
+        return key
+    m = LOC_RE.match(key)
+    return m.group(1) if m else key
+
+
+def read_log(path):
+    """Counter of (record key, var, value) for one test log"""
+    records = Counter()
+    with open(path, "r", encoding="utf-8", errors="ignore") as f:
+        for line in f:
+            line = line.strip()
+            key, sep, var_part = line.partition("\t")
+            if not sep:
+                continue
+            repeat = 1
+            head, sep, tail = var_part.rpartition("\t")
+            if sep and REPEAT_RE.match(tail):
+                var_part, repeat = head, int(tail[1:])
+            var, _, value = var_part.partition(":")
+            records[(key, var.strip(), value.strip())] += repeat
+    return records
+
+
+def generate(logs, paths, args):
+    """Map of the concatenated logs, as {key: {var: set of values}}"""
+    here = Path(__file__).resolve().parent
+    mapgen = here.parent / "mapgen" / "vase-mapgen"
+    generator = ([str(mapgen)] if os.access(mapgen, os.X_OK)
+                 else [sys.executable, str(here / "generate_limited_map.py")])
+    with tempfile.TemporaryDirectory(prefix="vase-min.") as tmp:
+        combined, out = Path(tmp) / "log.txt", Path(tmp) / "map.json"
+        with open(combined, "wb") as dst:
+            for name in logs:
+                dst.write(paths[name].read_bytes())
+        subprocess.run(generator + ["--log", str(combined), "--out", str(out),
+                                    "--max-values", str(args.max_values),
+                                    "--min-occurrence", str(args.min_occurrence), "--no-dedup"],
+                       stdout=subprocess.DEVNULL, check=True)
+        with open(out, "r", encoding="utf-8") as f:
+            output = json.load(f)
+    return {key: {var: {v["value"] for v in values} for var, values in vars.items()}
+            for key, vars in output.items()}
+
+
+def main():
+    args = parse_args()
+    paths = {p.stem: p for p in sorted(Path(args.test_logs).glob("*.txt"))}
+    if not paths:
+        print(f"❌ No test logs in {args.test_logs}")
+        return 1
+    logs = {name: read_log(path) for name, path in paths.items()}
+
+    # What the suite logged, and the (key, var) pairs that reached min occurrence
+    occurrence = Counter()
+    for records in logs.values():
+        for (key, var, _), n in records.items():
+            occurrence[(key, var)] += n
+    frequent = {kv for kv, n in occurrence.items() if n >= args.min_occurrence}
+    uncovered = set().union(*(set(r) for r in logs.values()))
+    short = {kv: args.min_occurrence for kv in frequent}
+
+    # Greedy: the test covering most missing triples and occurrences, then by name
+    chosen = []
+    remaining = sorted(logs)
+    while uncovered or short:
+        def gain(name):
+            records = logs[name]
+            occ = defaultdict(int)
+            for (key, var, _), n in records.items():
+                if (key, var) in short:
+                    occ[(key, var)] += n
+            return (len(uncovered.intersection(records)) +
+                    sum(min(n, short[kv]) for kv, n in occ.items()))
+        best = max(remaining, key=gain)
+        if gain(best) == 0:
+            break
+        remaining.remove(best)
+        chosen.append(best)
+        for (key, var, value), n in logs[best].items():
+            uncovered.discard((key, var, value))
+            if (key, var) in short:
+                short[(key, var)] -= n
+                if short[(key, var)] <= 0:
+                    del short[(key, var)]
+    greedy = len(chosen)
+
+    # The map also depends on counts (saturation, calling-context keys): verify
+    target = generate(sorted(logs), paths, args)
+    while True:
+        current = generate(chosen, paths, args)
+        differing = {site(k) for k in set(target) | set(current)
+                     if target.get(k) != current.get(k)}
+        if not differing or not remaining:
+            break
+
+        def relevant(name):
+            return sum(n for (key, _, _), n in logs[name].items() if site(key) in differing)
+        best = max(remaining, key=relevant)
+        if relevant(best) == 0:
+            break
+        remaining.remove(best)
+        chosen.append(best)
+
+    with open(args.out, "w", encoding="utf-8") as f:
+        for name in sorted(chosen):
+            f.write(name + "\n")
+    print(f"✅ Test subset written to {args.out}")
+    print(f"   tests: {len(chosen)} of {len(logs)} (greedy: {greedy}, added to match the map: "
+          f"{len(chosen) - greedy}), map {'identical' if current == target else 'DIFFERS'} "
+          f"in keys and values ({len(target)} entries)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Drop or demote map sites whose rewrites did not pay off in phase 3.
+
+VaseSolver --vase-site-stats records per site (loc:N) the queries, total
+solver time, and what the rewrites cost: candidate queries tried ("trials",
+"trial_us") and how many queries were answered rewritten ("rewritten"). With
+the same stats from a run without rewrites (--vase-profile-only, e.g. the
+vanilla run) as --baseline, a site's saving is
+
+    baseline solver_us per query * EVP queries - EVP solver_us
+
+A site whose saving is not above --min-saving-us is unprofitable: if none of
+its queries was ever rewritten it is dropped, otherwise it is demoted to its
+single most frequent value per var (fewer trials); a demoted site that is
+still unprofitable is dropped. Sites without a baseline are dropped only if
+they never rewrote a query in --min-trials trials or more.
+
+Decisions accumulate in --decisions across runs and are reapplied to every
+freshly generated map (call without --stats), so iterating the pipeline
+converges on a map of profitable sites.
+"""
+import argparse
+import json
+import os
+import re
+from collections import Counter
+
+LOC_RE = re.compile(r'^(loc:\d+)(?::|$)')
+BRANCH_RE = re.compile(r'^(loc:\d+):branch:\d+$')
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Prune unprofitable VASE map sites using phase-3 site stats")
+    p.add_argument("--map", required=True, help="limitedValuedMap.json to prune")
+    p.add_argument("--out", help="Pruned map (default: overwrite --map)")
+    p.add_argument("--decisions", required=True,
+                   help="Per-site drop/demote decisions, read and updated (e.g. prunedSites.json)")
+    p.add_argument("--stats", help="--vase-site-stats of the EVP run; without it, only reapply --decisions")
+    p.add_argument("--baseline", help="--vase-site-stats of a run without rewrites")
+    p.add_argument("--min-saving-us", type=float, default=0.0,
+                   help="Savings at or below this many microseconds make a site unprofitable (default: 0)")
+    p.add_argument("--min-trials", type=int, default=20,
+                   help="Trials without a single rewrite that drop a site lacking a baseline (default: 20)")
+    return p.parse_args()
+
+
+def load_json(path, default=None):
+    if path is None or not os.path.exists(path):
+        return default
+    with open(path, "r", encoding="utf-8") as f:
+        return json.load(f)
+
+
+def decide(evp, base, previous, args):
+    """New decision for one site, or None to leave it as it is."""
+    if evp.get("trials", 0) == 0:
+        return None  # no rewrite attempted: costs nothing
+    if base and base.get("queries"):
+        per_query = base["solver_us"] / base["queries"]
+        saving = per_query * evp["queries"] - evp["solver_us"]
+        if saving > args.min_saving_us:
+            return None
+    elif evp.get("rewritten", 0) or evp["trials"] < args.min_trials:
+        return None
+    if evp.get("rewritten", 0) and previous != "demote":
+        return "demote"
+    return "drop"
+
+
+def derive(output, loc, var):
+    """
+    The list a loc:N var written as [] (generate_limited_map.py dedup) stands
+    for: its loc:N:branch:B lists merged, weights summed, most observed
+    first, ties in numeric order (as VaseSolver derives it at load time).
+    """
+    counts = Counter()
+    for key, entry in output.items():
+        m = BRANCH_RE.match(key)
+        if m and m.group(1) == loc:
+            for e in entry.get(var, []):
+                counts[e["value"]] += e.get("weight", 0)
+    values = sorted(counts, key=lambda v: (-counts[v], int(v)))
+    return [{"type": 0, "value": v, "weight": counts[v]} for v in values]
+
+
+def apply(output, decisions):
+    dropped = demoted = 0
+    # Derived lists first, from the branch lists before they are demoted:
+    # truncating [] would leave the solver deriving the full union again
+    for key in list(output):
+        if decisions.get(key) == "demote":
+            for var, values in output[key].items():
+                if values == []:
+                    output[key][var] = derive(output, key, var)
+    for key in list(output):
+        m = LOC_RE.match(key)
+        decision = decisions.get(m.group(1)) if m else None
+        if decision == "drop":
+            del output[key]
+            dropped += 1
+        elif decision == "demote":
+            for var, values in output[key].items():
+                # Values are most frequent first (generate_limited_map.py)
+                output[key][var] = values[:1]
+            demoted += 1
+    return dropped, demoted
+
+
+def main():
+    args = parse_args()
+    output = load_json(args.map)
+    if output is None:
+        print(f"❌ Map not found: {args.map}")
+        return
+    decisions = load_json(args.decisions, {})
+
+    new = {}
+    if args.stats:
+        stats = load_json(args.stats)
+        if stats is None:
+            print(f"❌ Site stats not found: {args.stats}")
+            return
+        baseline = load_json(args.baseline, {})
+        for site, evp in stats.items():
+            decision = decide(evp, baseline.get(site), decisions.get(site), args)
+            if decision and decision != decisions.get(site):
+                new[site] = decision
+        decisions.update(new)
+        with open(args.decisions, "w", encoding="utf-8") as f:
+            json.dump(decisions, f, indent=2, sort_keys=True)
+
+    dropped, demoted = apply(output, decisions)
+    out_file = args.out or args.map
+    with open(out_file, "w", encoding="utf-8") as out:
+        json.dump(output, out, indent=2)
+
+    print(f"✅ Pruned map written to {out_file}")
+    print(f"   decisions: {len(decisions)} sites ({len(new)} new: "
+          f"drop={sum(d == 'drop' for d in new.values())} demote={sum(d == 'demote' for d in new.values())})")
+    print(f"   entries: dropped={dropped} demoted={demoted} kept={len(output)}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""Coverage-guided argv and input-file generation for an instrumented program.
+
+Runs the instrumented binary on mutated arguments and input files and keeps
+an input in the corpus when its value log reaches a site (loc:N, or
+loc:N:branch:B) that no kept input reached before. The log of every kept
+input is appended to --log, so the map generators see the corpus as extra
+tests. Stops after --plateau executions in a row without a new site, or
+after --max-time seconds.
+
+Options come from the program's --help output; "@@" in the arguments stands
+for the input file, which is fed on stdin otherwise. Every execution is a
+fresh process (coreutils main() is not re-entrant) in a scratch directory
+holding the input file as "input". Arguments never contain "/", so mutants
+cannot name files outside it; programs that run other programs or signal
+processes are refused unless --allow-unsafe. Logging uses the aggregating
+logger (VASE_AGGREGATE=1), one log per execution.
+"""
+import argparse
+import base64
+import json
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+SITE_RE = re.compile(r'^loc:-?\d+(?::branch:-?\d+)?')
+OPTION_RE = re.compile(r'(?<![\w-])(--?[A-Za-z0-9][\w-]*=?)')
+UNSAFE = {"kill", "env", "nice", "nohup", "timeout", "stdbuf", "chroot", "runcon", "su"}
+VALUES = ["0", "1", "-1", "2", "7", "10", "255", "256", "4096", "65536", "1K", "1M", "a", "-", ""]
+BYTES = [0x00, 0xff, 0x0a, 0x20, 0x09, 0x2d, 0x30, 0x39, 0x41, 0x7f, 0x80]
+FILE_ARG = "@@"
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Coverage-guided input generation for a VASE-instrumented program")
+    p.add_argument("--binary", required=True, help="Instrumented executable")
+    p.add_argument("--name", help="Program name, argv[0] (default: basename of --binary)")
+    p.add_argument("--log", required=True, help="Value log the kept inputs' records are appended to")
+    p.add_argument("--corpus", required=True, help="Corpus directory: seeds on start, the kept inputs on exit")
+    p.add_argument("--plateau", type=int, default=500,
+                   help="Stop after this many executions without a new site (default: 500)")
+    p.add_argument("--max-time", type=float, default=300, help="Time budget in seconds (default: 300)")
+    p.add_argument("--timeout", type=float, default=1.0, help="Per-execution timeout in seconds (default: 1)")
+    p.add_argument("--max-args", type=int, default=6)
+    p.add_argument("--max-len", type=int, default=256, help="Maximum input file size in bytes")
+    p.add_argument("--seed", type=int, default=0)
+    p.add_argument("--allow-unsafe", action="store_true",
+                   help=f"Fuzz programs that run commands or signal processes ({', '.join(sorted(UNSAFE))})")
+    return p.parse_args()
+
+
+class Runner:
+    def __init__(self, args):
+        self.binary = str(Path(args.binary).resolve())
+        self.name = args.name or Path(args.binary).name
+        self.timeout = args.timeout
+        self.work = Path(tempfile.mkdtemp(prefix="vase-fuzz."))
+        self.run_log = self.work / "run.log"
+        self.env = os.environ.copy()
+        self.env.pop("VASE_LOG_SHARD_DIR", None)
+        self.env["VASE_LOG"] = str(self.run_log)
+        self.env["VASE_AGGREGATE"] = "1"
+        self.execs = 0
+
+    def run(self, argv, data):
+        """(sites reached, log text) of one execution"""
+        scratch = self.work / "scratch"
+        shutil.rmtree(scratch, ignore_errors=True)
+        scratch.mkdir()
+        (scratch / "input").write_bytes(data)
+        if self.run_log.exists():
+            self.run_log.unlink()
+        use_file = FILE_ARG in argv
+        cmd = [self.name] + ["input" if a == FILE_ARG else a for a in argv]
+        self.execs += 1
+        try:
+            subprocess.run(cmd, executable=self.binary, cwd=scratch, env=self.env,
+                           input=None if use_file else data, stdin=subprocess.DEVNULL if use_file else None,
+                           stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, timeout=self.timeout)
+        except (subprocess.TimeoutExpired, OSError):
+            pass
+        if not self.run_log.exists():
+            return set(), ""
+        text = self.run_log.read_text(encoding="utf-8", errors="ignore")
+        sites = set()
+        for line in text.splitlines():
+            m = SITE_RE.match(line)
+            if m:
+                sites.add(m.group(0))
+        return sites, text
+
+    def close(self):
+        shutil.rmtree(self.work, ignore_errors=True)
+
+
+def help_options(runner):
+    """Options named in --help, "--opt=" for those taking a value"""
+    env = dict(runner.env, VASE_LOG=os.devnull)
+    try:
+        out = subprocess.run([runner.name, "--help"], executable=runner.binary, env=env,
+                             capture_output=True, text=True, errors="ignore", timeout=runner.timeout).stdout
+    except (subprocess.TimeoutExpired, OSError):
+        out = ""
+    return sorted({o for o in OPTION_RE.findall(out) if o not in ("-", "--")})
+
+
+def safe(argv):
+    return all("/" not in a for a in argv)
+
+
+def mutate_args(argv, options, corpus, rng, max_args):
+    argv = list(argv)
+    for _ in range(rng.randint(1, 3)):
+        op = rng.randrange(6)
+        if op == 0 and options:
+            token = rng.choice(options)
+            argv.insert(rng.randint(0, len(argv)), token + rng.choice(VALUES) if token.endswith("=") else token)
+        elif op == 1:
+            argv.insert(rng.randint(0, len(argv)), rng.choice(VALUES + [FILE_ARG]))
+        elif op == 2 and argv:
+            del argv[rng.randrange(len(argv))]
+        elif op == 3 and argv and options:
+            argv[rng.randrange(len(argv))] = rng.choice(options).rstrip("=")
+        elif op == 4 and argv:
+            i = rng.randrange(len(argv))
+            argv.insert(i, argv[i])
+        elif op == 5:
+            other = rng.choice(corpus)["args"]
+            if other:
+                i = rng.randrange(len(other))
+                argv[rng.randint(0, len(argv)):] = other[i:]
+    return argv[:max_args]
+
+
+def mutate_data(data, options, corpus, rng, max_len):
+    data = bytearray(data)
+    for _ in range(rng.randint(1, 4)):
+        op = rng.randrange(6)
+        if op == 0 and data:
+            data[rng.randrange(len(data))] ^= 1 << rng.randrange(8)
+        elif op == 1 and data:
+            data[rng.randrange(len(data))] = rng.choice(BYTES)
+        elif op == 2:
+            i = rng.randint(0, len(data))
+            data[i:i] = bytes(rng.randrange(256) for _ in range(rng.randint(1, 8)))
+        elif op == 3 and data:
+            i = rng.randrange(len(data))
+            del data[i:i + rng.randint(1, 8)]
+        elif op == 4:
+            other = rng.choice(corpus)["data"]
+            if other:
+                i = rng.randrange(len(other))
+                data[rng.randint(0, len(data)):] = other[i:i + rng.randint(1, 32)]
+        elif op == 5:
+            token = rng.choice(options + VALUES) if options else rng.choice(VALUES)
+            data += (token + rng.choice(["\n", " ", "\t"])).encode()
+    return bytes(data[:max_len])
+
+
+def load_corpus(corpus_dir):
+    corpus = []
+    for path in sorted(corpus_dir.glob("*.json")):
+        with open(path, "r", encoding="utf-8") as f:
+            entry = json.load(f)
+        corpus.append({"args": entry["args"], "data": base64.b64decode(entry["data"])})
+    return corpus
+
+
+def save_corpus(corpus_dir, corpus):
+    """Replace the corpus by the inputs kept this run (each added a site)"""
+    for path in corpus_dir.glob("*.json"):
+        path.unlink()
+    for i, entry in enumerate(corpus):
+        with open(corpus_dir / f"{i:06d}.json", "w", encoding="utf-8") as f:
+            json.dump({"args": entry["args"], "data": base64.b64encode(entry["data"]).decode()}, f)
+
+
+def main():
+    args = parse_args()
+    name = args.name or Path(args.binary).name
+    if name in UNSAFE and not args.allow_unsafe:
+        print(f"❌ Refusing to fuzz {name} without --allow-unsafe")
+        return 1
+    if not os.access(args.binary, os.X_OK):
+        print(f"❌ Binary not found: {args.binary}")
+        return 1
+    rng = random.Random(args.seed)
+    corpus_dir = Path(args.corpus)
+    corpus_dir.mkdir(parents=True, exist_ok=True)
+    runner = Runner(args)
+    try:
+        options = help_options(runner)
+        seeds = load_corpus(corpus_dir) or [{"args": [], "data": b""}, {"args": [FILE_ARG], "data": b"a b\n1 2\n"}]
+        seeds += [{"args": [o.rstrip("="), FILE_ARG], "data": b"a b\n1 2\n"} for o in options]
+
+        covered = set()
+        kept = []
+        start = time.monotonic()
+        with open(args.log, "a", encoding="utf-8") as log:
+            def consider(entry):
+                sites, text = runner.run(entry["args"], entry["data"])
+                if sites - covered:
+                    covered.update(sites)
+                    kept.append(entry)
+                    log.write(text)
+                    return True
+                return False
+
+            for entry in seeds:
+                consider(entry)
+            seed_sites = len(covered)
+            corpus = kept[:]
+            since_new = 0
+            while since_new < args.plateau and time.monotonic() - start < args.max_time and corpus:
+                parent = rng.choice(corpus)
+                entry = {"args": parent["args"], "data": parent["data"]}
+                if rng.random() < 0.5:
+                    entry["args"] = mutate_args(entry["args"], options, corpus, rng, args.max_args)
+                else:
+                    entry["data"] = mutate_data(entry["data"], options, corpus, rng, args.max_len)
+                if not safe(entry["args"]):
+                    continue
+                if consider(entry):
+                    corpus.append(entry)
+                    since_new = 0
+                else:
+                    since_new += 1
+
+        save_corpus(corpus_dir, kept)
+        stop = "plateau" if since_new >= args.plateau else "time"
+        print(f"✅ Fuzzed {name}: {runner.execs} executions in {time.monotonic() - start:.0f}s, stopped on {stop}")
+        print(f"   sites: {len(covered)} ({len(covered) - seed_sites} beyond seeds), "
+              f"corpus: {len(kept)} inputs -> {corpus_dir}, options from --help: {len(options)}")
+    finally:
+        runner.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,29 +1,471 @@
 //logger for Step 2: Instrumentation Pass (BranchLoggerPass.cpp) 3.5 file analysis
 
 
+#include <errno.h>
+#include <pthread.h>  // for pthread_atfork
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>   // for getenv
+#include <string.h>   // for memcpy
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
-void __vase_log_var(int locId, int branchTaken, const char *varName, int val) {
-    // No console noise: keep this disabled to avoid breaking program output
-    // printf("LOG: loc=%d branch=%d %s=%d\n", locId, branchTaken, varName, val);
+// ---- Calling context --------------------------------------------------------
+// The pass brackets every call site with __vase_ctx_push(id)/__vase_ctx_pop().
+// We keep the call-site ids on a per-thread ring (deep recursion just wraps)
+// and hash the k innermost frames, k = VASE_CTX_DEPTH (0/unset = off).
+// The analyzer splits entries by this hash (loc:N:ctx:H); VaseSolver reads the
+// same hash off a query's location tag and looks up the ctx key before the
+// plain loc:N:branch:B and loc:N ones.
+
+#define VASE_CTX_RING 64
+#define VASE_CTX_MAX_DEPTH 16
 
-    // Allow overriding the log path at runtime; default to vase_value_log.txt
+static __thread unsigned ctx_ring[VASE_CTX_RING];
+static __thread unsigned ctx_depth;
+static int ctx_k = -1;   // lazily read from VASE_CTX_DEPTH
+
+static int ctx_frames(void) {
+    if (ctx_k < 0) {
+        const char *s = getenv("VASE_CTX_DEPTH");
+        int k = (s && *s) ? atoi(s) : 0;
+        if (k < 0) k = 0;
+        if (k > VASE_CTX_MAX_DEPTH) k = VASE_CTX_MAX_DEPTH;
+        ctx_k = k;
+    }
+    return ctx_k;
+}
+
+void __vase_ctx_push(int callSiteId) {
+    ctx_ring[ctx_depth % VASE_CTX_RING] = (unsigned)callSiteId;
+    ctx_depth++;
+}
+
+void __vase_ctx_pop(void) {
+    if (ctx_depth > 0)
+        ctx_depth--;
+}
+
+// FNV-1a over the little-endian bytes of the k innermost call-site ids,
+// innermost first.
+unsigned __vase_ctx_hash(void) {
+    unsigned h = 2166136261u;
+    unsigned n = (unsigned)ctx_frames();
+    if (n > ctx_depth) n = ctx_depth;
+    for (unsigned i = 0; i < n; ++i) {
+        unsigned id = ctx_ring[(ctx_depth - 1 - i) % VASE_CTX_RING];
+        for (int b = 0; b < 4; ++b) {
+            h ^= (id >> (8 * b)) & 0xffu;
+            h *= 16777619u;
+        }
+    }
+    return h;
+}
+
+// Allow overriding the log path at runtime; default to vase_value_log.txt.
+// VASE_LOG_SHARD_DIR=DIR gives every process its own DIR/vase_value_log.PID.txt
+// instead, so tests running in parallel never append to the same file.
+static FILE *open_log(void) {
+    char shard[4096];
     const char *logpath = getenv("VASE_LOG");
-    if (!logpath || !*logpath) {
+    const char *shard_dir = getenv("VASE_LOG_SHARD_DIR");
+    if (shard_dir && *shard_dir) {
+        snprintf(shard, sizeof(shard), "%s/vase_value_log.%ld.txt",
+                 shard_dir, (long)getpid());
+        logpath = shard;
+    } else if (!logpath || !*logpath) {
         logpath = "vase_value_log.txt";
     }
 
     FILE *log = fopen(logpath, "a");   // append mode so multiple runs accumulate
-    if (!log) {
+    if (!log)
         perror("fopen VASE_LOG");
+    return log;
+}
+
+// ---- Aggregation (VASE_AGGREGATE=1) -----------------------------------------
+// A persistent driver (drivers/persistent_driver.h) replays thousands of
+// inputs in one process and logs the same records over and over. With
+// VASE_AGGREGATE=1 identical records are counted in memory instead, and each
+// is written once with its count (left out when 1) at exit, when the table
+// fills up, or on __vase_log_flush():
+//   loc:123:branch:1    argc:4    #250
+// A forked child starts with an empty table; records logged before the fork
+// are the parent's to write.
+
+#define VASE_AGG_SLOTS 65536   // power of two; flushed when half full
+
+struct agg_entry {
+    char *record;              // without the newline; NULL = free slot
+    unsigned hash;
+    unsigned long long count;
+};
+
+static struct agg_entry *agg_table;
+static unsigned agg_used;
+static int agg_mode = -1;      // lazily read from VASE_AGGREGATE
+static volatile int agg_lock;
+
+static void agg_discard(void) {
+    for (unsigned i = 0; agg_table && i < VASE_AGG_SLOTS; ++i) {
+        free(agg_table[i].record);
+        agg_table[i].record = NULL;
+    }
+    agg_used = 0;
+}
+
+static void agg_child(void) {
+    agg_discard();
+    agg_lock = 0;
+}
+
+// Caller holds agg_lock (or is the only thread left, at exit).
+static void agg_write(void) {
+    if (!agg_used)
+        return;
+    FILE *log = open_log();
+    for (unsigned i = 0; log && i < VASE_AGG_SLOTS; ++i) {
+        const struct agg_entry *a = &agg_table[i];
+        if (!a->record)
+            continue;
+        if (a->count == 1)
+            fprintf(log, "%s\n", a->record);
+        else
+            fprintf(log, "%s\t#%llu\n", a->record, a->count);
+    }
+    if (log)
+        fclose(log);
+    agg_discard();
+}
+
+void __vase_log_flush(void) {
+    if (!agg_table)
+        return;
+    int e = errno;
+    while (__sync_lock_test_and_set(&agg_lock, 1))
+        ;
+    agg_write();
+    __sync_lock_release(&agg_lock);
+    errno = e;
+}
+
+static int aggregating(void) {
+    if (agg_mode < 0) {
+        const char *s = getenv("VASE_AGGREGATE");
+        agg_mode = s && *s && strcmp(s, "0") != 0;
+        if (agg_mode) {
+            agg_table = calloc(VASE_AGG_SLOTS, sizeof(*agg_table));
+            if (!agg_table) {
+                agg_mode = 0;
+            } else {
+                atexit(__vase_log_flush);
+                pthread_atfork(NULL, NULL, agg_child);
+            }
+        }
+    }
+    return agg_mode;
+}
+
+static void agg_add(const char *record) {
+    unsigned h = 2166136261u;
+    for (const char *c = record; *c; ++c) {
+        h ^= (unsigned char)*c;
+        h *= 16777619u;
+    }
+    while (__sync_lock_test_and_set(&agg_lock, 1))
+        ;
+    if (agg_used >= VASE_AGG_SLOTS / 2)
+        agg_write();
+    unsigned i = h & (VASE_AGG_SLOTS - 1);
+    while (agg_table[i].record &&
+           (agg_table[i].hash != h || strcmp(agg_table[i].record, record) != 0))
+        i = (i + 1) & (VASE_AGG_SLOTS - 1);
+    struct agg_entry *a = &agg_table[i];
+    if (a->record) {
+        a->count++;
+    } else if ((a->record = strdup(record)) != NULL) {
+        a->hash = h;
+        a->count = 1;
+        agg_used++;
+    }
+    __sync_lock_release(&agg_lock);
+}
+
+// One record, "<key>\t<var>:<val>" without the newline: appended to the log,
+// or counted when aggregating. The program may be about to look at errno
+// (records are written right before branches and right after libc calls), so
+// logging must not change it.
+static void log_record(const char *fmt, ...) {
+    int e = errno;
+    char buf[512], *record = buf;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n >= (int)sizeof(buf) && (record = malloc((size_t)n + 1)) != NULL) {
+        va_start(ap, fmt);
+        vsnprintf(record, (size_t)n + 1, fmt, ap);
+        va_end(ap);
+    }
+    if (n < 0 || !record) {
+        errno = e;
         return;
     }
 
+    if (aggregating()) {
+        agg_add(record);
+    } else {
+        FILE *log = open_log();
+        if (log) {
+            fprintf(log, "%s\n", record);
+            fclose(log);   // fclose flushes; explicit fflush not needed here
+        }
+    }
+    if (record != buf)
+        free(record);
+    errno = e;
+}
+
+// ":ctx:%08x" when calling contexts are on, "" otherwise
+static const char *ctx_suffix(char buf[16]) {
+    buf[0] = '\0';
+    if (ctx_frames() > 0)
+        snprintf(buf, 16, ":ctx:%08x", __vase_ctx_hash());
+    return buf;
+}
+
+void __vase_log_var(int locId, int branchTaken, const char *varName, int val) {
+    // No console noise: keep this disabled to avoid breaking program output
+    // printf("LOG: loc=%d branch=%d %s=%d\n", locId, branchTaken, varName, val);
     // One line per observation; stable format used by Step 2
     // Example: loc:123:branch:1    argc:4
-    fprintf(log, "loc:%d:branch:%d\t%s:%d\n", locId, branchTaken, varName, val);
+    // With VASE_CTX_DEPTH=k:  loc:123:branch:1:ctx:9f1c03a2    argc:4
+    char ctx[16];
+    log_record("loc:%d:branch:%d%s\t%s:%d",
+               locId, branchTaken, ctx_suffix(ctx), varName, val);
+}
+
+// Loop-invariant operand, logged once per loop entry; no branch is known there.
+// Example: loc:123    len:16
+void __vase_log_site(int locId, const char *varName, int val) {
+    char ctx[16];
+    log_record("loc:%d%s\t%s:%d", locId, ctx_suffix(ctx), varName, val);
+}
+
+// Induction variable summary, logged at loop exit: the compare saw
+// start, start+step, ... (count values).
+// Example: loc:123:iv    i:0:1:16
+void __vase_log_iv(int locId, const char *varName, int start, int step, int count) {
+    char ctx[16];
+    log_record("loc:%d:iv%s\t%s:%d:%d:%d",
+               locId, ctx_suffix(ctx), varName, start, step, count);
+}
+
+// Switch discriminant: recorded as the 1-based index of the matching case in
+// the pass's case table, 0 for the default destination.
+// Example: loc:123:branch:2    c:104
+void __vase_log_switch(int locId, const char *varName, int val,
+                       const int *cases, int ncases) {
+    int branch = 0;
+    for (int i = 0; i < ncases; ++i) {
+        if (cases[i] == val) {
+            branch = i + 1;
+            break;
+        }
+    }
+    __vase_log_var(locId, branch, varName, val);
+}
+
+// Return value of a profiled libc call (-vase-libc-calls), at 64 bits so that
+// ssize_t and off_t results are whole, plus errno when it signals failure.
+// Example: loc:123    read:-1
+//          loc:123    errno:4
+void __vase_log_call(int locId, const char *varName, long long ret) {
+    int err = errno;
+    char ctx[16];
+    ctx_suffix(ctx);
+    log_record("loc:%d%s\t%s:%lld", locId, ctx, varName, ret);
+    if (ret < 0)
+        log_record("loc:%d%s\terrno:%d", locId, ctx, err);
+}
+
+// Out-parameter field of a profiled libc call (e.g. st_mode), read only when
+// the call succeeded (status >= 0), and logged at its full width: an 8-byte
+// field such as st_size keeps all 64 bits.
+// Example: loc:123    st_mode:33188
+void __vase_log_field(int locId, const char *varName, const void *addr,
+                      int width, long long status) {
+    if (status < 0 || !addr)
+        return;
+    long long v;
+    switch (width) {
+    case 1: { signed char x; memcpy(&x, addr, 1); v = x; break; }
+    case 2: { short x; memcpy(&x, addr, 2); v = x; break; }
+    case 4: { int x; memcpy(&x, addr, 4); v = x; break; }
+    case 8: { long long x; memcpy(&x, addr, 8); v = x; break; }
+    default: return;
+    }
+    char ctx[16];
+    log_record("loc:%d%s\t%s:%lld", locId, ctx_suffix(ctx), varName, v);
+}
+
+// ---- Input offsets (-vase-input-offsets) -----------------------------------
+// A shadow of where input bytes live: argv strings, and the buffers filled by
+// the read/fread/fgets calls the pass redirects to the wrappers below. Each
+// region remembers the KLEE array its bytes correspond to (arg00, arg01, ...
+// for --sym-args; stdin; A-data, B-data, ... for --sym-files, in the order
+// files are first read) and the offset of its first byte. A logged load that
+// falls inside a region is recorded as
+//   loc:123:input:arg00:1:1    c:45
+// i.e. var c was loaded from byte 1 (width 1) of arg00. Bytes the program
+// copies elsewhere are not followed.
+
+#define VASE_INPUT_REGIONS 256
+#define VASE_INPUT_FILES 26
+#define VASE_INPUT_FDS 1024
+
+struct input_region {
+    const char *lo, *hi;          // [lo, hi)
+    unsigned long offset;         // array offset of lo
+    char array[16];
+};
+
+static struct input_region regions[VASE_INPUT_REGIONS];
+static unsigned nregions;         // total ever added; newest wins on overlap
+
+static struct { dev_t dev; ino_t ino; } files[VASE_INPUT_FILES];
+static int nfiles;
+static unsigned long fd_offset[VASE_INPUT_FDS];   // for unseekable fds
+
+static void add_region(const void *addr, size_t len, const char *array,
+                       unsigned long offset) {
+    if (!addr || !len)
+        return;
+    struct input_region *r = &regions[nregions++ % VASE_INPUT_REGIONS];
+    r->lo = (const char *)addr;
+    r->hi = r->lo + len;
+    r->offset = offset;
+    snprintf(r->array, sizeof(r->array), "%s", array);
+}
+
+// stdin for fd 0, otherwise the file's letter by first-read order.
+static int fd_array(int fd, char array[16]) {
+    struct stat st;
+    if (fd == 0) {
+        snprintf(array, 16, "stdin");
+        return 1;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return 0;
+    int i;
+    for (i = 0; i < nfiles; ++i)
+        if (files[i].dev == st.st_dev && files[i].ino == st.st_ino)
+            break;
+    if (i == nfiles) {
+        if (nfiles == VASE_INPUT_FILES)
+            return 0;
+        files[nfiles].dev = st.st_dev;
+        files[nfiles].ino = st.st_ino;
+        nfiles++;
+    }
+    snprintf(array, 16, "%c-data", 'A' + i);
+    return 1;
+}
+
+// Offset of the next byte read from fd: the file position when it has one,
+// else a running count of bytes read.
+static unsigned long fd_position(int fd) {
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos >= 0)
+        return (unsigned long)pos;
+    return (fd >= 0 && fd < VASE_INPUT_FDS) ? fd_offset[fd] : 0;
+}
+
+static void note_read(int fd, const void *buf, long n, unsigned long offset) {
+    char array[16];
+    if (n <= 0)
+        return;
+    if (fd >= 0 && fd < VASE_INPUT_FDS)
+        fd_offset[fd] = offset + (unsigned long)n;
+    if (fd_array(fd, array))
+        add_region(buf, (size_t)n, array, offset);
+}
+
+// Called by the pass at the top of main; argv[i] is KLEE's arg%02d (i - 1),
+// which assumes every argument is symbolic (--sym-args / --sym-arg).
+void __vase_input_args(int argc, char **argv) {
+    char array[16];
+    for (int i = 1; i < argc && argv[i]; ++i) {
+        snprintf(array, sizeof(array), "arg%02d", i - 1);
+        add_region(argv[i], strlen(argv[i]), array, 0);
+    }
+}
+
+ssize_t __vase_read(int fd, void *buf, size_t n) {
+    unsigned long offset = fd_position(fd);
+    ssize_t got = read(fd, buf, n);
+    int e = errno;
+    note_read(fd, buf, got, offset);
+    errno = e;
+    return got;
+}
 
-    // fclose flushes; explicit fflush not needed here
-    fclose(log);
+ssize_t __vase_pread(int fd, void *buf, size_t n, off_t offset) {
+    ssize_t got = pread(fd, buf, n, offset);
+    int e = errno;
+    char array[16];
+    if (got > 0 && fd_array(fd, array))
+        add_region(buf, (size_t)got, array, (unsigned long)offset);
+    errno = e;
+    return got;
+}
+
+ssize_t __vase_pread64(int fd, void *buf, size_t n, off_t offset) {
+    return __vase_pread(fd, buf, n, offset);
+}
+
+// stdio keeps its own buffer, so the logical position comes from ftell.
+static unsigned long stream_position(FILE *f) {
+    long pos = ftell(f);
+    int fd = fileno(f);
+    if (pos >= 0)
+        return (unsigned long)pos;
+    return (fd >= 0 && fd < VASE_INPUT_FDS) ? fd_offset[fd] : 0;
+}
+
+size_t __vase_fread(void *buf, size_t size, size_t n, FILE *f) {
+    unsigned long offset = stream_position(f);
+    size_t got = fread(buf, size, n, f);
+    int e = errno;
+    note_read(fileno(f), buf, (long)(got * size), offset);
+    errno = e;
+    return got;
+}
+
+char *__vase_fgets(char *s, int n, FILE *f) {
+    unsigned long offset = stream_position(f);
+    char *r = fgets(s, n, f);
+    int e = errno;
+    if (r)
+        note_read(fileno(f), s, (long)strlen(s), offset);
+    errno = e;
+    return r;
+}
+
+// Logged operand loaded from `addr`: record the input bytes it came from, if
+// any. Context keys do not apply; arrays are global.
+void __vase_log_load(int locId, const char *varName, const void *addr,
+                     int width, long long val) {
+    const char *p = (const char *)addr;
+    unsigned n = nregions < VASE_INPUT_REGIONS ? nregions : VASE_INPUT_REGIONS;
+    for (unsigned i = 0; i < n; ++i) {
+        const struct input_region *r =
+            &regions[(nregions - 1 - i) % VASE_INPUT_REGIONS];
+        if (p < r->lo || p + width > r->hi)
+            continue;
+        log_record("loc:%d:input:%s:%lu:%d\t%s:%lld", locId, r->array,
+                   r->offset + (unsigned long)(p - r->lo), width, varName, val);
+        return;
+    }
 }
@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+# Build vase-mapgen, the native limitedValuedMap.json generator.
+#
+#   ./build.sh            (CXX defaults to c++)
+#
+# Output: vase-mapgen next to this script, which evp_pipeline.py prefers over
+# tools/analyzer/generate_limited_map.py when it exists.
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+CXX="${CXX:-c++}"
+OUT="$SCRIPT_DIR/vase-mapgen"
+
+"$CXX" -std=c++14 -O2 -g -Wall -pthread \
+  "$SCRIPT_DIR"/*.cpp \
+  -o "$OUT"
+
+echo "Built $OUT"
@@ -0,0 +1,1547 @@
+// vase_mapgen.cpp — native limitedValuedMap.json generator
+//
+//   vase-mapgen --log vase_value_log.txt --out limitedValuedMap.json
+//               [--max-values 8] [--min-occurrence 3] [--static-map F] ...
+//
+// Drop-in for tools/analyzer/generate_limited_map.py: same options, same
+// summary, and byte-for-byte the same JSON for logs written by
+// tools/logger/logger.c (UTF-8, integers that fit in 64 bits). The log is
+// mmapped and cut into newline-aligned chunks parsed on all cores; each chunk
+// keeps keys in first-seen order, so merging chunks in file order reproduces
+// the Python dict order. A var stops collecting distinct values at
+// max_values + 1, which is all `limited` needs to know.
+//
+// Unless --no-dedup, a loc:N var whose list VaseSolver can derive from the
+// loc:N:branch:B lists is written as [] (see dedupBranchless).
+//
+// --binary-out writes the same entries in the VASEMAP2 format VaseSolver also
+// loads (see writeBinaryMap); only "type", "value" and "weight" are kept.
+//
+// --state FILE makes runs incremental: the per-var sketches (bounded distinct
+// set, occurrence count, saturation flag) are loaded from FILE, the logs are
+// merged in, and FILE is rewritten. Only new log data is parsed, and with
+// --truncate-log the logs are emptied once merged, so the appending logger
+// starts over. See readState.
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// ---- Insertion-ordered map (Python dict order) ------------------------------
+
+template <typename V> class OrderedMap {
+public:
+  V &operator[](const std::string &key) {
+    auto it = index.find(key);
+    if (it != index.end())
+      return items[it->second].second;
+    index.emplace(key, items.size());
+    items.emplace_back(key, V());
+    return items.back().second;
+  }
+  const V *find(const std::string &key) const {
+    auto it = index.find(key);
+    return it == index.end() ? nullptr : &items[it->second].second;
+  }
+  size_t size() const { return items.size(); }
+  bool empty() const { return items.empty(); }
+  typename std::vector<std::pair<std::string, V>>::const_iterator begin() const { return items.begin(); }
+  typename std::vector<std::pair<std::string, V>>::const_iterator end() const { return items.end(); }
+  typename std::vector<std::pair<std::string, V>>::iterator begin() { return items.begin(); }
+  typename std::vector<std::pair<std::string, V>>::iterator end() { return items.end(); }
+
+private:
+  std::unordered_map<std::string, size_t> index;
+  std::vector<std::pair<std::string, V>> items;
+};
+
+// ---- JSON values as Python's json module sees them --------------------------
+
+struct JValue {
+  enum Kind { Null, Bool, Int, Float, String, Array, Object } kind = Null;
+  bool b = false;
+  std::string text; // Int: canonical digits; String: UTF-8
+  double f = 0;
+  std::vector<JValue> items;
+  OrderedMap<JValue> members;
+
+  static JValue string(const std::string &s) {
+    JValue v;
+    v.kind = String;
+    v.text = s;
+    return v;
+  }
+  static JValue integer(long long i) {
+    JValue v;
+    v.kind = Int;
+    v.text = std::to_string(i);
+    return v;
+  }
+
+  // len() in Python
+  size_t length() const {
+    switch (kind) {
+    case Array: return items.size();
+    case Object: return members.size();
+    case String: return text.size();
+    default: return 0;
+    }
+  }
+};
+
+bool operator==(const JValue &a, const JValue &b);
+
+bool membersEqual(const OrderedMap<JValue> &a, const OrderedMap<JValue> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (const auto &kv : a) {
+    const JValue *other = b.find(kv.first);
+    if (!other || !(kv.second == *other))
+      return false;
+  }
+  return true;
+}
+
+bool operator==(const JValue &a, const JValue &b) {
+  if (a.kind != b.kind)
+    return false;
+  switch (a.kind) {
+  case JValue::Null: return true;
+  case JValue::Bool: return a.b == b.b;
+  case JValue::Int:
+  case JValue::String: return a.text == b.text;
+  case JValue::Float: return a.f == b.f;
+  case JValue::Array: return a.items == b.items;
+  case JValue::Object: return membersEqual(a.members, b.members);
+  }
+  return false;
+}
+
+class JsonParser {
+public:
+  explicit JsonParser(const std::string &s) : s(s) {}
+
+  JValue parse() {
+    JValue v = value();
+    ws();
+    if (pos != s.size())
+      fail("extra data");
+    return v;
+  }
+
+private:
+  const std::string &s;
+  size_t pos = 0;
+
+  [[noreturn]] void fail(const char *what) {
+    throw std::runtime_error(std::string(what) + " at offset " + std::to_string(pos));
+  }
+  void ws() {
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r'))
+      ++pos;
+  }
+  bool literal(const char *word) {
+    size_t n = strlen(word);
+    if (s.compare(pos, n, word) != 0)
+      return false;
+    pos += n;
+    return true;
+  }
+
+  JValue value() {
+    ws();
+    if (pos >= s.size())
+      fail("unexpected end of JSON");
+    JValue v;
+    char c = s[pos];
+    if (c == '{') {
+      ++pos;
+      v.kind = JValue::Object;
+      ws();
+      if (pos < s.size() && s[pos] == '}') {
+        ++pos;
+        return v;
+      }
+      for (;;) {
+        ws();
+        if (pos >= s.size() || s[pos] != '"')
+          fail("expected object key");
+        std::string key = str();
+        ws();
+        if (pos >= s.size() || s[pos++] != ':')
+          fail("expected ':'");
+        v.members[key] = value(); // duplicate keys: last value, first position
+        ws();
+        if (pos < s.size() && s[pos] == ',') {
+          ++pos;
+          continue;
+        }
+        if (pos < s.size() && s[pos] == '}') {
+          ++pos;
+          return v;
+        }
+        fail("expected ',' or '}'");
+      }
+    }
+    if (c == '[') {
+      ++pos;
+      v.kind = JValue::Array;
+      ws();
+      if (pos < s.size() && s[pos] == ']') {
+        ++pos;
+        return v;
+      }
+      for (;;) {
+        v.items.push_back(value());
+        ws();
+        if (pos < s.size() && s[pos] == ',') {
+          ++pos;
+          continue;
+        }
+        if (pos < s.size() && s[pos] == ']') {
+          ++pos;
+          return v;
+        }
+        fail("expected ',' or ']'");
+      }
+    }
+    if (c == '"') {
+      v.kind = JValue::String;
+      v.text = str();
+      return v;
+    }
+    if (literal("true")) {
+      v.kind = JValue::Bool;
+      v.b = true;
+      return v;
+    }
+    if (literal("false")) {
+      v.kind = JValue::Bool;
+      return v;
+    }
+    if (literal("null"))
+      return v;
+    if (literal("NaN")) {
+      v.kind = JValue::Float;
+      v.f = NAN;
+      return v;
+    }
+    if (literal("Infinity")) {
+      v.kind = JValue::Float;
+      v.f = INFINITY;
+      return v;
+    }
+    if (literal("-Infinity")) {
+      v.kind = JValue::Float;
+      v.f = -INFINITY;
+      return v;
+    }
+    return number();
+  }
+
+  JValue number() {
+    size_t start = pos;
+    bool isFloat = false;
+    if (pos < s.size() && s[pos] == '-')
+      ++pos;
+    size_t digits = pos;
+    while (pos < s.size() && isdigit((unsigned char)s[pos]))
+      ++pos;
+    if (pos == digits)
+      fail("expecting value");
+    if (pos < s.size() && s[pos] == '.') {
+      isFloat = true;
+      ++pos;
+      while (pos < s.size() && isdigit((unsigned char)s[pos]))
+        ++pos;
+    }
+    if (pos < s.size() && (s[pos] == 'e' || s[pos] == 'E')) {
+      isFloat = true;
+      ++pos;
+      if (pos < s.size() && (s[pos] == '+' || s[pos] == '-'))
+        ++pos;
+      while (pos < s.size() && isdigit((unsigned char)s[pos]))
+        ++pos;
+    }
+    JValue v;
+    std::string token = s.substr(start, pos - start);
+    if (isFloat) {
+      v.kind = JValue::Float;
+      v.f = strtod(token.c_str(), nullptr);
+    } else {
+      v.kind = JValue::Int;
+      bool neg = token[0] == '-';
+      size_t first = token.find_first_not_of('0', neg ? 1 : 0);
+      v.text = first == std::string::npos ? "0" : (neg ? "-" : "") + token.substr(first);
+    }
+    return v;
+  }
+
+  static void utf8(std::string &out, uint32_t cp) {
+    if (cp < 0x80) {
+      out += (char)cp;
+    } else if (cp < 0x800) {
+      out += (char)(0xc0 | (cp >> 6));
+      out += (char)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) { // lone surrogates too, as Python keeps them
+      out += (char)(0xe0 | (cp >> 12));
+      out += (char)(0x80 | ((cp >> 6) & 0x3f));
+      out += (char)(0x80 | (cp & 0x3f));
+    } else {
+      out += (char)(0xf0 | (cp >> 18));
+      out += (char)(0x80 | ((cp >> 12) & 0x3f));
+      out += (char)(0x80 | ((cp >> 6) & 0x3f));
+      out += (char)(0x80 | (cp & 0x3f));
+    }
+  }
+
+  uint32_t hex4() {
+    if (pos + 4 > s.size())
+      fail("invalid \\uXXXX escape");
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+      char c = s[pos++];
+      v <<= 4;
+      if (c >= '0' && c <= '9') v |= c - '0';
+      else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+      else fail("invalid \\uXXXX escape");
+    }
+    return v;
+  }
+
+  std::string str() {
+    ++pos; // opening quote
+    std::string out;
+    for (;;) {
+      if (pos >= s.size())
+        fail("unterminated string");
+      char c = s[pos++];
+      if (c == '"')
+        return out;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (pos >= s.size())
+        fail("unterminated string");
+      char e = s[pos++];
+      switch (e) {
+      case '"': out += '"'; break;
+      case '\\': out += '\\'; break;
+      case '/': out += '/'; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        uint32_t cp = hex4();
+        if (cp >= 0xd800 && cp < 0xdc00 && s.compare(pos, 2, "\\u") == 0) {
+          size_t save = pos;
+          pos += 2;
+          uint32_t lo = hex4();
+          if (lo >= 0xdc00 && lo < 0xe000)
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+          else
+            pos = save;
+        }
+        utf8(out, cp);
+        break;
+      }
+      default: fail("invalid escape");
+      }
+    }
+  }
+};
+
+// ---- Python-compatible json.dump(indent=2) ----------------------------------
+
+// repr(float): shortest round-tripping digits, exponent form outside
+// 1e-4 <= |x| < 1e16.
+std::string pyFloatRepr(double d) {
+  if (std::isnan(d)) return "NaN";
+  if (std::isinf(d)) return d > 0 ? "Infinity" : "-Infinity";
+  if (d == 0) return std::signbit(d) ? "-0.0" : "0.0";
+  char buf[40];
+  for (int prec = 1; prec <= 17; ++prec) {
+    snprintf(buf, sizeof(buf), "%.*e", prec - 1, d);
+    if (strtod(buf, nullptr) == d)
+      break;
+  }
+  std::string sci = buf;
+  bool neg = sci[0] == '-';
+  size_t epos = sci.find('e');
+  std::string mant = sci.substr(neg ? 1 : 0, epos - (neg ? 1 : 0));
+  int exp = atoi(sci.c_str() + epos + 1);
+  std::string digits;
+  for (char c : mant)
+    if (c != '.')
+      digits += c;
+  while (digits.size() > 1 && digits.back() == '0')
+    digits.pop_back();
+
+  std::string out = neg ? "-" : "";
+  if (exp < -4 || exp >= 16) {
+    out += digits[0];
+    if (digits.size() > 1)
+      out += "." + digits.substr(1);
+    char e[16];
+    snprintf(e, sizeof(e), "e%c%02d", exp < 0 ? '-' : '+', std::abs(exp));
+    return out + e;
+  }
+  if (exp < 0)
+    return out + "0." + std::string(-exp - 1, '0') + digits;
+  if ((size_t)exp + 1 >= digits.size())
+    return out + digits + std::string(exp + 1 - digits.size(), '0') + ".0";
+  return out + digits.substr(0, exp + 1) + "." + digits.substr(exp + 1);
+}
+
+// ensure_ascii escaping; invalid UTF-8 bytes are dropped like the analyzer's
+// errors="ignore" decoding.
+void dumpString(std::string &out, const std::string &s) {
+  static const char hex[] = "0123456789abcdef";
+  auto u = [&](uint32_t cp) {
+    out += "\\u";
+    for (int shift = 12; shift >= 0; shift -= 4)
+      out += hex[(cp >> shift) & 0xf];
+  };
+  out += '"';
+  for (size_t i = 0; i < s.size();) {
+    unsigned char c = (unsigned char)s[i];
+    uint32_t cp;
+    size_t n;
+    if (c < 0x80) { cp = c; n = 1; }
+    else if ((c & 0xe0) == 0xc0) { cp = c & 0x1f; n = 2; }
+    else if ((c & 0xf0) == 0xe0) { cp = c & 0x0f; n = 3; }
+    else if ((c & 0xf8) == 0xf0) { cp = c & 0x07; n = 4; }
+    else { ++i; continue; }
+    bool ok = i + n <= s.size();
+    for (size_t k = 1; ok && k < n; ++k) {
+      unsigned char cc = (unsigned char)s[i + k];
+      ok = (cc & 0xc0) == 0x80;
+      cp = (cp << 6) | (cc & 0x3f);
+    }
+    if (!ok) { ++i; continue; }
+    i += n;
+    switch (cp) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    case '\b': out += "\\b"; break;
+    case '\f': out += "\\f"; break;
+    default:
+      if (cp >= 0x20 && cp < 0x7f) {
+        out += (char)cp;
+      } else if (cp > 0xffff) {
+        cp -= 0x10000;
+        u(0xd800 | (cp >> 10));
+        u(0xdc00 | (cp & 0x3ff));
+      } else {
+        u(cp);
+      }
+    }
+  }
+  out += '"';
+}
+
+void dump(std::string &out, const JValue &v, int depth) {
+  auto newline = [&](int d) {
+    out += '\n';
+    out.append(2 * d, ' ');
+  };
+  switch (v.kind) {
+  case JValue::Null: out += "null"; return;
+  case JValue::Bool: out += v.b ? "true" : "false"; return;
+  case JValue::Int: out += v.text; return;
+  case JValue::Float: out += pyFloatRepr(v.f); return;
+  case JValue::String: dumpString(out, v.text); return;
+  case JValue::Array:
+    if (v.items.empty()) {
+      out += "[]";
+      return;
+    }
+    out += '[';
+    for (size_t i = 0; i < v.items.size(); ++i) {
+      if (i)
+        out += ',';
+      newline(depth + 1);
+      dump(out, v.items[i], depth + 1);
+    }
+    newline(depth);
+    out += ']';
+    return;
+  case JValue::Object: {
+    if (v.members.empty()) {
+      out += "{}";
+      return;
+    }
+    out += '{';
+    bool first = true;
+    for (const auto &kv : v.members) {
+      if (!first)
+        out += ',';
+      first = false;
+      newline(depth + 1);
+      dumpString(out, kv.first);
+      out += ": ";
+      dump(out, kv.second, depth + 1);
+    }
+    newline(depth);
+    out += '}';
+    return;
+  }
+  }
+}
+
+// ---- Python int() for value strings ------------------------------------------
+
+// Sign and magnitude digits (no leading zeros) of a string int() accepts:
+// optional sign, digits with single '_' separators. Surrounding whitespace is
+// already stripped.
+bool pyInt(const std::string &s, bool &neg, std::string &digits) {
+  size_t i = 0;
+  neg = false;
+  if (i < s.size() && (s[i] == '+' || s[i] == '-'))
+    neg = s[i++] == '-';
+  digits.clear();
+  bool lastDigit = false;
+  for (; i < s.size(); ++i) {
+    char c = s[i];
+    if (isdigit((unsigned char)c)) {
+      digits += c;
+      lastDigit = true;
+    } else if (c == '_' && lastDigit && i + 1 < s.size() && isdigit((unsigned char)s[i + 1])) {
+      lastDigit = false;
+    } else {
+      return false;
+    }
+  }
+  if (digits.empty())
+    return false;
+  size_t first = digits.find_first_not_of('0');
+  digits = first == std::string::npos ? "0" : digits.substr(first);
+  if (digits == "0")
+    neg = false;
+  return true;
+}
+
+struct PyIntKey {
+  bool neg;
+  std::string digits;
+  bool operator<(const PyIntKey &o) const {
+    if (neg != o.neg)
+      return neg;
+    int c = digits.size() != o.digits.size()
+                ? (digits.size() < o.digits.size() ? -1 : 1)
+                : digits.compare(o.digits);
+    return neg ? c > 0 : c < 0;
+  }
+};
+
+bool pyInt64(const std::string &s, long long &out) {
+  bool neg;
+  std::string digits;
+  if (!pyInt(s, neg, digits) || digits.size() > 19)
+    return false;
+  errno = 0;
+  unsigned long long mag = strtoull(digits.c_str(), nullptr, 10);
+  if (errno || mag > (unsigned long long)LLONG_MAX + (neg ? 1 : 0))
+    return false;
+  out = neg ? (long long)(0 - mag) : (long long)mag;
+  return true;
+}
+
+std::string int128String(__int128 v) {
+  if (v == 0)
+    return "0";
+  bool neg = v < 0;
+  unsigned __int128 m = neg ? -(unsigned __int128)v : (unsigned __int128)v;
+  std::string s;
+  while (m) {
+    s += (char)('0' + (int)(m % 10));
+    m /= 10;
+  }
+  if (neg)
+    s += '-';
+  std::reverse(s.begin(), s.end());
+  return s;
+}
+
+// ---- Log aggregation -----------------------------------------------------------
+
+struct Options {
+  std::vector<std::string> logs;
+  std::string out = "limitedValuedMap.json";
+  std::string binaryOut;
+  long long maxValues = 8;
+  long long minOccurrence = 3;
+  bool branchless = true;
+  bool context = true;
+  bool inputs = true;
+  bool dedup = true;
+  std::string staticMap;
+  std::string carryMap;
+  unsigned jobs = 0;
+  std::string state;
+  bool truncateLog = false;
+};
+
+// Distinct values of one var and how often each was seen, until there are
+// `cap` (= max_values + 1) of them; from then on the var is saturated (never
+// limited) and keeps none.
+struct ValueSet {
+  std::vector<std::string> values;
+  std::vector<long long> counts; // parallel to values
+  long long occ = 0;
+  bool saturated = false;
+
+  void add(const std::string &v, size_t cap, long long seen = 1) {
+    if (saturated)
+      return;
+    size_t i = std::find(values.begin(), values.end(), v) - values.begin();
+    if (i < values.size()) {
+      counts[i] += seen;
+      return;
+    }
+    values.push_back(v);
+    counts.push_back(seen);
+    if (values.size() >= cap)
+      saturate();
+  }
+  void merge(const ValueSet &o, size_t cap) {
+    if (o.saturated)
+      saturate();
+    for (size_t i = 0; i < o.values.size(); ++i)
+      add(o.values[i], cap, o.counts[i]);
+    occ += o.occ;
+  }
+  void saturate() {
+    saturated = true;
+    std::vector<std::string>().swap(values);
+    std::vector<long long>().swap(counts);
+  }
+};
+
+using VarMap = OrderedMap<ValueSet>;
+using BranchMap = OrderedMap<VarMap>;
+const char *const NoBranch = "*";
+
+struct Aggregate {
+  OrderedMap<BranchMap> values;              // [loc][branch][var]
+  OrderedMap<OrderedMap<BranchMap>> ctx;     // [loc][ctx][branch][var]
+  OrderedMap<VarMap> inputs;                 // ["loc:array:off:w"][var]
+  long long total = 0, good = 0, negBranch = 0, malformed = 0;
+
+  void merge(Aggregate &o, size_t cap) {
+    for (auto &loc : o.values)
+      mergeBranches(values[loc.first], loc.second, cap);
+    for (auto &loc : o.ctx)
+      for (auto &c : loc.second)
+        mergeBranches(ctx[loc.first][c.first], c.second, cap);
+    for (auto &in : o.inputs)
+      mergeVars(inputs[in.first], in.second, cap);
+    total += o.total;
+    good += o.good;
+    negBranch += o.negBranch;
+    malformed += o.malformed;
+  }
+  static void mergeVars(VarMap &to, const VarMap &from, size_t cap) {
+    for (auto &var : from)
+      to[var.first].merge(var.second, cap);
+  }
+  static void mergeBranches(BranchMap &to, const BranchMap &from, size_t cap) {
+    for (auto &b : from)
+      mergeVars(to[b.first], b.second, cap);
+  }
+};
+
+// str.strip() for the whitespace an ASCII log can contain
+bool isPySpace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r') || (c >= '\x1c' && c <= '\x1f');
+}
+
+std::string strip(const char *b, const char *e) {
+  while (b < e && isPySpace(*b)) ++b;
+  while (e > b && isPySpace(e[-1])) --e;
+  return std::string(b, e);
+}
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// [-]digits at s[i..]; advances i
+bool signedDigits(const std::string &s, size_t &i) {
+  size_t start = i;
+  if (i < s.size() && s[i] == '-')
+    ++i;
+  size_t d = i;
+  while (i < s.size() && isDigit(s[i]))
+    ++i;
+  if (i == d) {
+    i = start;
+    return false;
+  }
+  return true;
+}
+
+bool startsAt(const std::string &s, size_t i, const char *lit) {
+  return s.compare(i, strlen(lit), lit) == 0;
+}
+
+// ^loc:(-?\d+)(?::branch:(-?\d+)|:(iv))?(?::ctx:([0-9a-fA-F]+))?$
+bool matchLoc(const std::string &s, std::string &loc, std::string &branch,
+              bool &hasBranch, bool &iv, std::string &ctx, bool &hasCtx) {
+  if (!startsAt(s, 0, "loc:"))
+    return false;
+  size_t i = 4;
+  if (!signedDigits(s, i))
+    return false;
+  loc = s.substr(4, i - 4);
+  hasBranch = iv = hasCtx = false;
+  if (startsAt(s, i, ":branch:")) {
+    size_t j = i + 8;
+    if (signedDigits(s, j)) {
+      branch = s.substr(i + 8, j - i - 8);
+      hasBranch = true;
+      i = j;
+    }
+  } else if (startsAt(s, i, ":iv")) {
+    iv = true;
+    i += 3;
+  }
+  if (startsAt(s, i, ":ctx:")) {
+    size_t j = i + 5;
+    while (j < s.size() && isxdigit((unsigned char)s[j]))
+      ++j;
+    if (j > i + 5) {
+      ctx = s.substr(i + 5, j - i - 5);
+      hasCtx = true;
+      i = j;
+    }
+  }
+  return i == s.size();
+}
+
+// ^loc:(-?\d+):input:([^:]+):(\d+):(\d+)$  ->  "loc:array:off:w"
+bool matchInput(const std::string &s, std::string &key) {
+  if (!startsAt(s, 0, "loc:"))
+    return false;
+  size_t i = 4;
+  if (!signedDigits(s, i) || !startsAt(s, i, ":input:"))
+    return false;
+  const size_t locEnd = i;
+  i += 7;
+  size_t a = i;
+  while (i < s.size() && s[i] != ':')
+    ++i;
+  if (i == a)
+    return false;
+  for (int field = 0; field < 2; ++field) {
+    if (i >= s.size() || s[i] != ':')
+      return false;
+    size_t d = ++i;
+    while (i < s.size() && isDigit(s[i]))
+      ++i;
+    if (i == d)
+      return false;
+  }
+  if (i != s.size())
+    return false;
+  key = s.substr(4, locEnd - 4) + ":" + s.substr(a);
+  return true;
+}
+
+// "#N", N >= 1 without leading zeros, at s[i..]: the repeat count of an
+// aggregated record (logger VASE_AGGREGATE=1)
+bool matchRepeat(const std::string &s, size_t i, long long &repeat) {
+  if (i + 1 >= s.size() || s[i] != '#' || s[i + 1] == '0' || s.size() - i - 1 > 18)
+    return false;
+  long long n = 0;
+  for (++i; i < s.size(); ++i) {
+    if (!isDigit(s[i]))
+      return false;
+    n = n * 10 + (s[i] - '0');
+  }
+  repeat = n;
+  return true;
+}
+
+void parseLine(const char *b, const char *e, Aggregate &agg, const Options &opt) {
+  const size_t cap = (size_t)std::max<long long>(opt.maxValues + 1, 0);
+  std::string line = strip(b, e);
+  if (line.empty())
+    return;
+  size_t tab = line.find('\t');
+  if (tab == std::string::npos) {
+    ++agg.malformed;
+    return;
+  }
+  std::string locPart = line.substr(0, tab), varPart = line.substr(tab + 1);
+  long long repeat = 1;
+  size_t last = varPart.rfind('\t');
+  if (last != std::string::npos && matchRepeat(varPart, last + 1, repeat))
+    varPart.resize(last);
+
+  std::string loc, branch, ctx, inputKey;
+  bool hasBranch, iv, hasCtx;
+  if (!matchLoc(locPart, loc, branch, hasBranch, iv, ctx, hasCtx)) {
+    size_t colon = varPart.find(':');
+    std::string name = strip(varPart.data(), varPart.data() + std::min(colon, varPart.size()));
+    std::string value = colon == std::string::npos
+                            ? ""
+                            : strip(varPart.data() + colon + 1, varPart.data() + varPart.size());
+    if (matchInput(locPart, inputKey) && !name.empty() && !value.empty()) {
+      ValueSet &vs = agg.inputs[inputKey][name];
+      vs.add(value, cap, repeat);
+      vs.occ += repeat;
+      ++agg.good;
+      return;
+    }
+    ++agg.malformed;
+    return;
+  }
+
+  if (!hasBranch) {
+    branch = NoBranch;
+  } else {
+    // negative branches (e.g., function entry) are not decision points
+    size_t nz = branch.find_first_not_of("-0");
+    if (branch[0] == '-' && nz != std::string::npos) {
+      ++agg.negBranch;
+      return;
+    }
+  }
+
+  size_t colon = varPart.find(':');
+  if (colon == std::string::npos) {
+    ++agg.malformed;
+    return;
+  }
+  std::string name = strip(varPart.data(), varPart.data() + colon);
+  std::string value = strip(varPart.data() + colon + 1, varPart.data() + varPart.size());
+  if (name.empty()) {
+    ++agg.malformed;
+    return;
+  }
+
+  std::vector<std::string> values;
+  long long count = 1;
+  if (iv) {
+    std::vector<std::string> parts;
+    std::stringstream ss(value);
+    std::string part;
+    while (std::getline(ss, part, ':'))
+      parts.push_back(part);
+    if (!value.empty() && value.back() == ':')
+      parts.push_back("");
+    long long start, step;
+    if (parts.size() != 3 || !pyInt64(strip(parts[0].data(), parts[0].data() + parts[0].size()), start) ||
+        !pyInt64(strip(parts[1].data(), parts[1].data() + parts[1].size()), step) ||
+        !pyInt64(strip(parts[2].data(), parts[2].data() + parts[2].size()), count)) {
+      ++agg.malformed;
+      return;
+    }
+    if (count <= 0)
+      return;
+    long long n = step ? std::min<long long>(count, opt.maxValues + 1) : 1;
+    for (long long k = 0; k < n; ++k)
+      values.push_back(int128String((__int128)start + (__int128)k * step));
+  } else {
+    values.push_back(value);
+  }
+
+  // A constant IV was compared `count` times, a stepping one once per value.
+  const long long seen = (values.size() == 1 ? count : 1) * repeat;
+  count *= repeat;
+  ValueSet &vs = agg.values[loc][branch][name];
+  for (const std::string &v : values)
+    vs.add(v, cap, seen);
+  vs.occ += count;
+  if (hasCtx) {
+    std::transform(ctx.begin(), ctx.end(), ctx.begin(), ::tolower);
+    ValueSet &cs = agg.ctx[loc][ctx][branch][name];
+    for (const std::string &v : values)
+      cs.add(v, cap, seen);
+    cs.occ += count;
+  }
+  ++agg.good;
+}
+
+// Lines as Python's universal-newline iteration sees them.
+void parseChunk(const char *b, const char *e, Aggregate &agg, const Options &opt) {
+  const char *line = b;
+  for (const char *p = b; p < e; ++p) {
+    if (*p != '\n' && *p != '\r')
+      continue;
+    ++agg.total;
+    parseLine(line, p, agg, opt);
+    if (*p == '\r' && p + 1 < e && p[1] == '\n')
+      ++p;
+    line = p + 1;
+  }
+  if (line < e) {
+    ++agg.total;
+    parseLine(line, e, agg, opt);
+  }
+}
+
+bool parseLog(const std::string &path, Aggregate &agg, const Options &opt) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = (size_t)st.st_size;
+  if (size == 0) {
+    close(fd);
+    return true;
+  }
+  void *mem = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED)
+    return false;
+  madvise(mem, size, MADV_SEQUENTIAL);
+  const char *data = (const char *)mem;
+
+  // Chunks end right after a '\n' (a "\r\n" pair is never split).
+  unsigned jobs = opt.jobs ? opt.jobs : std::max(1u, std::thread::hardware_concurrency());
+  const size_t minChunk = 1 << 20;
+  jobs = (unsigned)std::max<size_t>(1, std::min<size_t>(jobs, size / minChunk + 1));
+  std::vector<const char *> bounds{data};
+  for (unsigned k = 1; k < jobs; ++k) {
+    const char *p = std::max(bounds.back(), data + size / jobs * k);
+    const char *nl = (const char *)memchr(p, '\n', data + size - p);
+    if (!nl)
+      break;
+    bounds.push_back(nl + 1);
+  }
+  bounds.push_back(data + size);
+
+  std::vector<Aggregate> parts(bounds.size() - 1);
+  std::vector<std::thread> threads;
+  for (size_t k = 0; k + 1 < bounds.size(); ++k)
+    threads.emplace_back(parseChunk, bounds[k], bounds[k + 1], std::ref(parts[k]), std::cref(opt));
+  for (std::thread &t : threads)
+    t.join();
+  munmap(mem, size);
+
+  const size_t cap = (size_t)std::max<long long>(opt.maxValues + 1, 0);
+  for (Aggregate &part : parts)
+    agg.merge(part, cap);
+  return true;
+}
+
+// ---- Map construction (generate_limited_map.py steps 1-5) --------------------
+
+// Most observed first, ties in numeric order (string order unless all are ints).
+JValue rankedValues(const ValueSet &vs) {
+  const std::vector<std::string> &vals = vs.values;
+  std::vector<PyIntKey> keys(vals.size());
+  bool allInts = true;
+  for (size_t i = 0; i < vals.size() && allInts; ++i)
+    allInts = pyInt(vals[i], keys[i].neg, keys[i].digits);
+  std::vector<size_t> order(vals.size());
+  for (size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  if (allInts)
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+  else
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return vals[a] < vals[b]; });
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return vs.counts[a] > vs.counts[b]; });
+  JValue list;
+  list.kind = JValue::Array;
+  for (size_t i : order) {
+    JValue entry;
+    entry.kind = JValue::Object;
+    entry.members["type"] = JValue::integer(0);
+    entry.members["value"] = JValue::string(vals[i]);
+    entry.members["weight"] = JValue::integer(vs.counts[i]);
+    list.items.push_back(std::move(entry));
+  }
+  return list;
+}
+
+JValue limited(const VarMap &vars, const Options &opt) {
+  JValue out;
+  out.kind = JValue::Object;
+  for (const auto &var : vars) {
+    if (var.second.occ < opt.minOccurrence)
+      continue;
+    if (!var.second.saturated && (long long)var.second.values.size() <= opt.maxValues)
+      out.members[var.first] = rankedValues(var.second);
+  }
+  return out;
+}
+
+// Same vars with the same values in the same order, whatever the weights.
+bool sameRanking(const JValue &a, const JValue &b) {
+  if (a.members.size() != b.members.size())
+    return false;
+  for (const auto &var : a.members) {
+    const JValue *other = b.members.find(var.first);
+    if (!other || other->items.size() != var.second.items.size())
+      return false;
+    for (size_t i = 0; i < var.second.items.size(); ++i)
+      if (!(*var.second.items[i].members.find("value") ==
+            *other->items[i].members.find("value")))
+        return false;
+  }
+  return true;
+}
+
+VarMap unionOf(const BranchMap &branches, size_t cap) {
+  VarMap u;
+  for (const auto &b : branches)
+    for (const auto &var : b.second)
+      u[var.first].merge(var.second, cap);
+  return u;
+}
+
+JValue readJsonFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("cannot read " + path);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::string text = ss.str();
+  if (text.compare(0, 3, "\xef\xbb\xbf") == 0)
+    text.erase(0, 3);
+  try {
+    return JsonParser(text).parse();
+  } catch (const std::exception &e) {
+    throw std::runtime_error(path + ": " + e.what());
+  }
+}
+
+// Add vars the log produced no entry for; returns how many were added.
+long long fillIn(JValue &output, const std::string &path, const long long *maxValues) {
+  JValue extra = readJsonFile(path);
+  if (extra.kind != JValue::Object)
+    throw std::runtime_error(path + ": expected an object");
+  long long added = 0;
+  for (auto &key : extra.members) {
+    if (key.second.kind != JValue::Object)
+      throw std::runtime_error(path + ": entry " + key.first + " is not an object");
+    for (auto &var : key.second.members) {
+      const JValue *have = output.members.find(key.first);
+      if (have && have->members.find(var.first))
+        continue;
+      if (maxValues && (long long)var.second.length() > *maxValues)
+        continue;
+      JValue &entry = output.members[key.first];
+      entry.kind = JValue::Object;
+      entry.members[var.first] = var.second;
+      ++added;
+    }
+  }
+  return added;
+}
+
+// 6) A loc:N var whose list is exactly what VaseSolver derives from the
+// loc:N:branch:B lists (values merged, weights summed, ranked again) becomes
+// []. Returns how many vars were replaced.
+long long dedupBranchless(JValue &output) {
+  OrderedMap<std::vector<const JValue *>> branchKeys; // loc -> branch entries
+  for (const auto &key : output.members) {
+    const std::string &k = key.first;
+    size_t i = 4, b;
+    if (k.compare(0, 4, "loc:") != 0 || !signedDigits(k, i) ||
+        k.compare(i, 8, ":branch:") != 0)
+      continue;
+    b = i + 8;
+    if (!signedDigits(k, b) || b != k.size())
+      continue;
+    branchKeys[k.substr(4, i - 4)].push_back(&key.second);
+  }
+  long long derived = 0;
+  for (const auto &loc : branchKeys) {
+    if (!output.members.find("loc:" + loc.first))
+      continue;
+    for (auto &var : output.members["loc:" + loc.first].members) {
+      ValueSet vs;
+      bool ok = true;
+      for (const JValue *entry : loc.second) {
+        const JValue *list = entry->members.find(var.first);
+        for (size_t j = 0; list && ok && j < list->items.size(); ++j) {
+          const JValue &e = list->items[j];
+          const JValue *value = e.kind == JValue::Object ? e.members.find("value") : nullptr;
+          const JValue *weight = e.kind == JValue::Object ? e.members.find("weight") : nullptr;
+          ok = value && value->kind == JValue::String && weight && weight->kind == JValue::Int;
+          if (ok)
+            vs.add(value->text, SIZE_MAX, atoll(weight->text.c_str()));
+        }
+      }
+      if (ok && var.second.length() != 0 && var.second == rankedValues(vs)) {
+        var.second.items.clear();
+        ++derived;
+      }
+    }
+  }
+  return derived;
+}
+
+// ---- Binary map ------------------------------------------------------------------
+// "VASEMAP2", u32 #keys, then per key: str key, u32 #vars, per var: str name,
+// u32 #values, per value: i32 type, str value, u64 weight (0 = none).
+// str = u32 length + bytes; integers little-endian. Values without an integer
+// "type" and a string "value" are dropped, as VaseSolver's JSON loader does.
+
+void putU32(std::string &out, uint32_t v) {
+  for (int i = 0; i < 4; ++i)
+    out += (char)((v >> (8 * i)) & 0xff);
+}
+
+void putU64(std::string &out, uint64_t v) {
+  putU32(out, (uint32_t)v);
+  putU32(out, (uint32_t)(v >> 32));
+}
+
+void putStr(std::string &out, const std::string &s) {
+  putU32(out, (uint32_t)s.size());
+  out += s;
+}
+
+bool writeBinaryMap(const JValue &output, const std::string &path) {
+  std::string out = "VASEMAP2";
+  putU32(out, (uint32_t)output.members.size());
+  for (const auto &key : output.members) {
+    putStr(out, key.first);
+    putU32(out, (uint32_t)key.second.members.size());
+    for (const auto &var : key.second.members) {
+      putStr(out, var.first);
+      std::vector<const JValue *> values;
+      for (const JValue &v : var.second.items) {
+        const JValue *type = v.members.find("type");
+        const JValue *value = v.members.find("value");
+        if (type && value && type->kind == JValue::Int && value->kind == JValue::String)
+          values.push_back(&v);
+      }
+      putU32(out, (uint32_t)values.size());
+      for (const JValue *v : values) {
+        const JValue *weight = v->members.find("weight");
+        putU32(out, (uint32_t)atol(v->members.find("type")->text.c_str()));
+        putStr(out, v->members.find("value")->text);
+        putU64(out, weight && weight->kind == JValue::Int
+                        ? strtoull(weight->text.c_str(), nullptr, 10) : 0);
+      }
+    }
+  }
+  std::ofstream f(path, std::ios::binary);
+  f << out;
+  return (bool)f;
+}
+
+// ---- Sketch state (--state) --------------------------------------------------------
+// "VASESTATE3", u32 cap, then the three tables of Aggregate in first-seen
+// order, each as nested u32-counted maps of str keys down to a ValueSet:
+// u64 occ, u8 saturated, u32 #values, then per value str value, u64 count. A state written with a
+// different cap still merges: a smaller cap saturates the larger sets, and
+// sets saturated under a smaller cap stay saturated (their values are gone),
+// so raising --max-values needs a rebuild from the logs.
+
+const char StateMagic[] = "VASESTATE3"; // 3: input keys carry their site
+
+void putSet(std::string &out, const ValueSet &vs) {
+  putU64(out, (uint64_t)vs.occ);
+  out += (char)(vs.saturated ? 1 : 0);
+  putU32(out, (uint32_t)vs.values.size());
+  for (size_t i = 0; i < vs.values.size(); ++i) {
+    putStr(out, vs.values[i]);
+    putU64(out, (uint64_t)vs.counts[i]);
+  }
+}
+
+template <typename V, typename F>
+void putMap(std::string &out, const OrderedMap<V> &m, F putValue) {
+  putU32(out, (uint32_t)m.size());
+  for (const auto &kv : m) {
+    putStr(out, kv.first);
+    putValue(out, kv.second);
+  }
+}
+
+void putVars(std::string &out, const VarMap &vars) { putMap(out, vars, putSet); }
+void putBranches(std::string &out, const BranchMap &b) { putMap(out, b, putVars); }
+
+class StateReader {
+public:
+  StateReader(const std::string &data) : data(data) {}
+
+  bool magic() {
+    size_t n = strlen(StateMagic);
+    if (data.compare(0, n, StateMagic) != 0)
+      return false;
+    pos = n;
+    return true;
+  }
+  uint32_t u32() {
+    need(4);
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i)
+      v |= (uint32_t)(unsigned char)data[pos++] << (8 * i);
+    return v;
+  }
+  uint64_t u64() {
+    uint64_t lo = u32();
+    return lo | ((uint64_t)u32() << 32);
+  }
+  std::string str() {
+    uint32_t n = u32();
+    need(n);
+    pos += n;
+    return data.substr(pos - n, n);
+  }
+  ValueSet set() {
+    ValueSet vs;
+    vs.occ = (long long)u64();
+    need(1);
+    vs.saturated = data[pos++] != 0;
+    for (uint32_t n = u32(); n > 0; --n) {
+      vs.values.push_back(str());
+      vs.counts.push_back((long long)u64());
+    }
+    return vs;
+  }
+  template <typename V, typename F> void map(OrderedMap<V> &m, F readValue) {
+    for (uint32_t n = u32(); n > 0; --n) {
+      std::string key = str();
+      readValue(m[key]);
+    }
+  }
+  void vars(VarMap &to, size_t cap) {
+    map(to, [&](ValueSet &vs) { vs.merge(set(), cap); });
+  }
+  void branches(BranchMap &to, size_t cap) {
+    map(to, [&](VarMap &v) { vars(v, cap); });
+  }
+  bool atEnd() const { return pos == data.size(); }
+
+private:
+  const std::string &data;
+  size_t pos = 0;
+
+  void need(size_t n) {
+    if (data.size() - pos < n)
+      throw std::runtime_error("truncated state");
+  }
+};
+
+// Merges FILE into agg. A missing file is an empty state.
+bool readState(const std::string &path, Aggregate &agg, size_t cap) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return access(path.c_str(), F_OK) != 0;
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::string data = ss.str();
+  StateReader r(data);
+  try {
+    if (!r.magic())
+      throw std::runtime_error("not a vase-mapgen state file (or an older format; delete it)");
+    size_t savedCap = r.u32();
+    if (savedCap < cap)
+      fprintf(stderr, "vase-mapgen: %s was built with --max-values %zu; vars "
+                      "saturated then stay unlimited\n", path.c_str(), savedCap - 1);
+    r.map(agg.values, [&](BranchMap &b) { r.branches(b, cap); });
+    r.map(agg.ctx, [&](OrderedMap<BranchMap> &c) {
+      r.map(c, [&](BranchMap &b) { r.branches(b, cap); });
+    });
+    r.map(agg.inputs, [&](VarMap &v) { r.vars(v, cap); });
+    if (!r.atEnd())
+      throw std::runtime_error("trailing data");
+  } catch (const std::exception &e) {
+    fprintf(stderr, "vase-mapgen: %s: %s\n", path.c_str(), e.what());
+    return false;
+  }
+  return true;
+}
+
+// Written next to FILE and renamed over it, so a crash never leaves half a state.
+bool writeState(const std::string &path, const Aggregate &agg, size_t cap) {
+  std::string out = StateMagic;
+  putU32(out, (uint32_t)cap);
+  putMap(out, agg.values, putBranches);
+  putMap(out, agg.ctx, [](std::string &o, const OrderedMap<BranchMap> &c) {
+    putMap(o, c, putBranches);
+  });
+  putMap(out, agg.inputs, putVars);
+
+  std::string tmp = path + ".tmp";
+  {
+    std::ofstream f(tmp, std::ios::binary);
+    f << out;
+    if (!f)
+      return false;
+  }
+  return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// ---- Driver ------------------------------------------------------------------------
+
+void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--log FILE]... [--out FILE] [--binary-out FILE]\n"
+          "       [--max-values N] [--min-occurrence N] [--no-branchless]\n"
+          "       [--no-context] [--no-input-offsets] [--no-dedup] [--static-map FILE]\n"
+          "       [--carry-map FILE] [--jobs N] [--state FILE [--truncate-log]]\n",
+          argv0);
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i], value;
+    size_t eq = arg.find('=');
+    bool inlineValue = arg.compare(0, 2, "--") == 0 && eq != std::string::npos;
+    if (inlineValue) {
+      value = arg.substr(eq + 1);
+      arg = arg.substr(0, eq);
+    }
+    auto next = [&](std::string &to) {
+      if (inlineValue) {
+        to = value;
+        return true;
+      }
+      if (i + 1 >= argc)
+        return false;
+      to = argv[++i];
+      return true;
+    };
+    auto nextInt = [&](long long &to) {
+      std::string s;
+      return next(s) && pyInt64(s, to);
+    };
+    auto nextUnsigned = [&](unsigned &to) {
+      long long v;
+      if (!nextInt(v) || v < 0)
+        return false;
+      to = (unsigned)v;
+      return true;
+    };
+
+    bool ok = true;
+    if (arg == "--log") {
+      std::string log;
+      ok = next(log);
+      opt.logs.push_back(log);
+    } else if (arg == "--out") ok = next(opt.out);
+    else if (arg == "--binary-out") ok = next(opt.binaryOut);
+    else if (arg == "--max-values") ok = nextInt(opt.maxValues);
+    else if (arg == "--min-occurrence") ok = nextInt(opt.minOccurrence);
+    else if (arg == "--no-branchless") opt.branchless = false;
+    else if (arg == "--no-context") opt.context = false;
+    else if (arg == "--no-input-offsets") opt.inputs = false;
+    else if (arg == "--no-dedup") opt.dedup = false;
+    else if (arg == "--static-map") ok = next(opt.staticMap);
+    else if (arg == "--carry-map") ok = next(opt.carryMap);
+    else if (arg == "--jobs") ok = nextUnsigned(opt.jobs);
+    else if (arg == "--state") ok = next(opt.state);
+    else if (arg == "--truncate-log") opt.truncateLog = true;
+    else if (arg == "-h" || arg == "--help") {
+      usage(argv[0]);
+      exit(0);
+    } else {
+      fprintf(stderr, "vase-mapgen: unrecognized argument %s\n", argv[i]);
+      ok = false;
+    }
+    if (!ok) {
+      usage(argv[0]);
+      return false;
+    }
+  }
+  if (opt.logs.empty())
+    opt.logs.push_back("vase_value_log.txt");
+  if (opt.truncateLog && opt.state.empty()) {
+    fprintf(stderr, "vase-mapgen: --truncate-log needs --state (the log is the only copy otherwise)\n");
+    return false;
+  }
+  return true;
+}
+
+int run(const Options &opt) {
+  const size_t cap = (size_t)std::max<long long>(opt.maxValues + 1, 0);
+  Aggregate agg;
+  if (!opt.state.empty() && !readState(opt.state, agg, cap))
+    return 1;
+  size_t stateLocs = agg.values.size();
+  for (const std::string &log : opt.logs) {
+    if (access(log.c_str(), F_OK) != 0) {
+      if (!opt.state.empty())
+        continue; // already merged and discarded
+      printf("❌ Log file not found: %s\n", log.c_str());
+      return 0;
+    }
+    if (!parseLog(log, agg, opt)) {
+      fprintf(stderr, "vase-mapgen: cannot read %s: %s\n", log.c_str(), strerror(errno));
+      return 1;
+    }
+  }
+
+  JValue output;
+  output.kind = JValue::Object;
+
+  // 1) Branch-qualified
+  for (const auto &loc : agg.values)
+    for (const auto &b : loc.second) {
+      if (b.first == NoBranch)
+        continue;
+      JValue vars = limited(b.second, opt);
+      if (!vars.members.empty())
+        output.members["loc:" + loc.first + ":branch:" + b.first] = std::move(vars);
+    }
+
+  // 2) Base (branchless)
+  if (opt.branchless)
+    for (const auto &loc : agg.values) {
+      JValue vars = limited(unionOf(loc.second, cap), opt);
+      if (!vars.members.empty())
+        output.members["loc:" + loc.first] = std::move(vars);
+    }
+
+  // 3) Context-qualified, where different from the merged key
+  long long ctxEntries = 0;
+  if (opt.context)
+    for (const auto &loc : agg.ctx)
+      for (const auto &c : loc.second) {
+        std::vector<std::pair<std::pair<std::string, std::string>, JValue>> keys;
+        for (const auto &b : c.second)
+          if (b.first != NoBranch)
+            keys.push_back({{"loc:" + loc.first + ":branch:" + b.first,
+                             "loc:" + loc.first + ":branch:" + b.first + ":ctx:" + c.first},
+                            limited(b.second, opt)});
+        if (opt.branchless)
+          keys.push_back({{"loc:" + loc.first, "loc:" + loc.first + ":ctx:" + c.first},
+                          limited(unionOf(c.second, cap), opt)});
+        for (auto &k : keys) {
+          const JValue *merged = output.members.find(k.first.first);
+          if (!k.second.members.empty() && !(merged && sameRanking(*merged, k.second))) {
+            output.members[k.first.second] = std::move(k.second);
+            ++ctxEntries;
+          }
+        }
+      }
+
+  // 3b) Input bytes, sorted by (loc, array, offset, width)
+  long long inputEntries = 0;
+  if (opt.inputs) {
+    struct InputKey {
+      std::string loc, array;
+      PyIntKey site, offset, width;
+      const std::pair<std::string, VarMap> *entry;
+    };
+    std::vector<InputKey> keys;
+    for (const auto &in : agg.inputs) {
+      size_t l = in.first.find(':');
+      size_t w = in.first.rfind(':'), o = in.first.rfind(':', w - 1);
+      InputKey k{in.first.substr(0, l), in.first.substr(l + 1, o - l - 1), {}, {}, {}, &in};
+      pyInt(k.loc, k.site.neg, k.site.digits);
+      pyInt(in.first.substr(o + 1, w - o - 1), k.offset.neg, k.offset.digits);
+      pyInt(in.first.substr(w + 1), k.width.neg, k.width.digits);
+      keys.push_back(std::move(k));
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const InputKey &a, const InputKey &b) {
+      if (a.site < b.site || b.site < a.site)
+        return a.site < b.site;
+      if (a.array != b.array)
+        return a.array < b.array;
+      if (a.offset < b.offset || b.offset < a.offset)
+        return a.offset < b.offset;
+      return a.width < b.width;
+    });
+    for (const InputKey &k : keys) {
+      JValue vars = limited(k.entry->second, opt);
+      if (!vars.members.empty()) {
+        output.members["loc:" + k.loc + ":arr:" + k.entry->first.substr(k.loc.size() + 1)] =
+            std::move(vars);
+        ++inputEntries;
+      }
+    }
+  }
+
+  long long staticVars = 0, carriedVars = 0;
+  try {
+    // 4) Static value sets (no occurrence threshold; dynamic entries win)
+    if (!opt.staticMap.empty())
+      staticVars = fillIn(output, opt.staticMap, &opt.maxValues);
+    // 5) Entries of functions unchanged since the last profiled build
+    if (!opt.carryMap.empty())
+      carriedVars = fillIn(output, opt.carryMap, nullptr);
+  } catch (const std::exception &e) {
+    fprintf(stderr, "vase-mapgen: %s\n", e.what());
+    return 1;
+  }
+  long long derivedVars = opt.dedup ? dedupBranchless(output) : 0;
+
+  std::string text;
+  dump(text, output, 0);
+  std::ofstream out(opt.out, std::ios::binary);
+  out << text;
+  if (!out) {
+    fprintf(stderr, "vase-mapgen: cannot write %s\n", opt.out.c_str());
+    return 1;
+  }
+  if (!opt.binaryOut.empty() && !writeBinaryMap(output, opt.binaryOut)) {
+    fprintf(stderr, "vase-mapgen: cannot write %s\n", opt.binaryOut.c_str());
+    return 1;
+  }
+
+  if (!opt.state.empty()) {
+    if (!writeState(opt.state, agg, cap)) {
+      fprintf(stderr, "vase-mapgen: cannot write %s\n", opt.state.c_str());
+      return 1;
+    }
+    if (opt.truncateLog)
+      for (const std::string &log : opt.logs)
+        if (access(log.c_str(), F_OK) == 0 && truncate(log.c_str(), 0) != 0)
+          fprintf(stderr, "vase-mapgen: cannot truncate %s: %s\n", log.c_str(), strerror(errno));
+  }
+
+  printf("✅ Done. Written limited-valued map to %s\n", opt.out.c_str());
+  printf("   lines: total=%lld good=%lld malformed=%lld skipped_neg_branch=%lld\n",
+         agg.total, agg.good, agg.malformed, agg.negBranch);
+  printf("   entries: %zu (context-qualified: %lld, input-offset: %lld, static vars: %lld, "
+         "carried vars: %lld, derived vars: %lld)\n",
+         output.members.size(), ctxEntries, inputEntries, staticVars, carriedVars, derivedVars);
+  printf("   thresholds: MIN_OCCURRENCE=%lld MAX_LIMITED_VALUES=%lld branchless=%s\n",
+         opt.minOccurrence, opt.maxValues, opt.branchless ? "on" : "off");
+  if (!opt.state.empty())
+    printf("   state: %s (sites: %zu before, %zu after this run)\n", opt.state.c_str(),
+           stateLocs, agg.values.size());
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt))
+    return 2;
+  return run(opt);
+}
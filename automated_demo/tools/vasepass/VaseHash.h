@@ -0,0 +1,37 @@
+// VaseHash.h — 32-bit FNV-1a, the one hash every VASE id is built from
+//
+// Call-site ids, calling-context hashes (logger.c __vase_ctx_hash) and
+// stable site ids all use it; keep the byte order (little-endian for
+// integers) in sync with the logger's copy.
+
+#ifndef VASE_HASH_H
+#define VASE_HASH_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+
+namespace vase {
+
+static const uint32_t FnvOffset = 2166136261u;
+static const uint32_t FnvPrime = 16777619u;
+
+inline uint32_t fnvBytes(uint32_t h, llvm::StringRef bytes) {
+  for (unsigned char c : bytes) {
+    h ^= c;
+    h *= FnvPrime;
+  }
+  return h;
+}
+
+inline uint32_t fnvU32(uint32_t h, uint32_t v) {
+  for (unsigned b = 0; b < 4; ++b) {
+    h ^= (v >> (8 * b)) & 0xffu;
+    h *= FnvPrime;
+  }
+  return h;
+}
+
+} // namespace vase
+
+#endif // VASE_HASH_H
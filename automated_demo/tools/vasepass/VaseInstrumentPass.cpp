@@ -0,0 +1,1089 @@
+// VaseInstrumentPass.cpp — VASE branch-operand value logging (opt plugin)
+//
+//   opt -load libVaseInstrumentPass.so -vase-instrument in.bc -o out.bc
+//
+// Every conditional branch whose condition may depend on program input gets
+//   __vase_log_var(locId, successorTaken, "<var>", value)
+// per integer operand of the condition, right before the branch; selects are
+// treated the same way (arm taken). Switches get
+//   __vase_log_switch(locId, "<var>", value, caseTable, numCases)
+// and the runtime turns the value into the case index. Calls to the libc
+// functions listed in -vase-libc-calls (VaseLibcCalls.h) get
+//   __vase_log_call(locId, "<fn>", ret) / __vase_log_field(...)
+// right after the call. The runtime
+// is tools/logger/logger.c; the log feeds tools/analyzer/generate_limited_map.py.
+//
+// Operands that cannot depend on argv/stdin/file data are never part of a
+// symbolic query, so VaseSolver could not use them; by default they are left
+// uninstrumented (see VaseTaint.h).
+//
+// Inside loops (-vase-loop-hoist, on by default) logging is moved out of the
+// loop body where that loses nothing: a site whose condition is loop-invariant
+// is logged once in the preheader, an invariant operand of a varying condition
+// is logged once as a branchless record (__vase_log_site), and an affine
+// induction variable is summarized once at the loop exit as
+// (start, step, count) (__vase_log_iv), which the analyzer expands back into
+// the values the compare saw.
+//
+// With -vase-static-map=FILE, operands whose value set can be proven
+// statically (see VaseStaticValues.h) are written to FILE as loc:N entries in
+// the limitedValuedMap.json schema, each value marked "static": true, and are
+// not instrumented; the analyzer merges FILE back in with --static-map.
+//
+// Site ids are stable hashes by default (-vase-site-ids=stable, see
+// VaseSiteIds.h). -vase-site-manifest=FILE lists every function with its
+// structural hash and site ids; -vase-changed-since=OLD_MANIFEST instruments
+// only the functions whose hash differs from OLD_MANIFEST, so after a rebuild
+// only changed code is re-profiled (tools/analyzer/diff_site_manifest.py
+// carries the old map entries of everything else forward).
+//
+// With -vase-input-offsets, logged operands that are loads also get
+//   __vase_log_load(locId, "<var>", address, width, value)
+// and read/pread/fread/fgets calls are redirected to logger wrappers that
+// remember which buffers hold which input bytes, so the runtime can record
+// the KLEE array and offset a value came from (loc:N:arr:NAME:OFF:W map entries).
+//
+// -vase-hot-sites=FILE takes the per-site statistics of a short KLEE run
+// (--vase-site-stats, usually with --vase-profile-only) and instruments only
+// the -vase-hot-top-k sites that cost the solver the most time; every other
+// site keeps its id but is left alone.
+
+#include "VaseHash.h"
+#include "VaseLibcCalls.h"
+#include "VaseSiteIds.h"
+#include "VaseStaticValues.h"
+#include "VaseTaint.h"
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/LazyValueInfo.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Local.h" // findDbgUsers (LLVM 10)
+#if LLVM_VERSION_MAJOR >= 11
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+#else
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#endif
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "vase-instrument"
+
+STATISTIC(NumSites, "Conditional branches seen");
+STATISTIC(NumSwitchSites, "Switches seen");
+STATISTIC(NumSelectSites, "Selects seen");
+STATISTIC(NumLibcSites, "Profiled libc call sites");
+STATISTIC(NumSitesInstrumented, "Branches, switches and selects instrumented");
+STATISTIC(NumOperandsFiltered, "Branch operands skipped as input-independent");
+STATISTIC(NumCallSites, "Call sites bracketed for calling context");
+STATISTIC(NumSitesHoisted, "Loop sites logged once in a preheader");
+STATISTIC(NumOperandsHoisted, "Invariant operands logged once in a preheader");
+STATISTIC(NumIVSummaries, "Induction variables summarized at loop exit");
+STATISTIC(NumOperandsStatic, "Branch operands with a static value set");
+STATISTIC(NumSitesStatic, "Branches fully covered by static value sets");
+STATISTIC(NumFunctionsUnchanged, "Functions skipped as unchanged since the old manifest");
+STATISTIC(NumInputLoads, "Logged loads traced back to input bytes");
+STATISTIC(NumInputReads, "Input reads redirected to the logger's wrappers");
+STATISTIC(NumSitesCold, "Sites skipped as not hot in -vase-hot-sites");
+
+static cl::opt<bool> TaintFilter(
+  "vase-taint-filter",
+  cl::desc("Only log branch operands that may depend on program input "
+           "(argv, stdin, file reads)"),
+  cl::init(true));
+
+static cl::list<std::string> ExtraInputFuncs(
+  "vase-input-funcs",
+  cl::desc("Additional functions whose results and pointer arguments carry input"),
+  cl::CommaSeparated);
+
+static cl::opt<bool> ProfileSwitches(
+  "vase-switch",
+  cl::desc("Log switch discriminants keyed by case index (loc:N:branch:K, "
+           "K = 0 for default)"),
+  cl::init(true));
+
+static cl::opt<bool> ProfileSelects(
+  "vase-select",
+  cl::desc("Log select conditions like two-way branches"),
+  cl::init(true));
+
+static cl::list<std::string> LibcCalls(
+  "vase-libc-calls",
+  cl::desc("Log return values and out-parameter fields of these libc calls: "
+           "name[:ARG@OFF:WIDTH[=alias]], or 'default'"),
+  cl::CommaSeparated);
+
+static cl::opt<bool> LoopHoist(
+  "vase-loop-hoist",
+  cl::desc("Log loop-invariant operands once per loop entry and summarize "
+           "induction-variable compares at loop exit"),
+  cl::init(true));
+
+static cl::opt<std::string> StaticMapPath(
+  "vase-static-map",
+  cl::desc("Write statically inferred value sets to this file "
+           "(limitedValuedMap.json schema)"),
+  cl::value_desc("path"), cl::init(""));
+
+static cl::opt<unsigned> StaticMaxValues(
+  "vase-static-max-values",
+  cl::desc("Largest static value set worth a map entry"),
+  cl::init(8));
+
+static cl::opt<bool> StaticSkip(
+  "vase-static-skip",
+  cl::desc("Do not instrument operands covered by -vase-static-map"),
+  cl::init(true));
+
+static cl::opt<vase::SiteIds::Scheme> SiteIdScheme(
+  "vase-site-ids",
+  cl::desc("How loc:N site ids are assigned"),
+  cl::values(clEnumValN(vase::SiteIds::Stable, "stable",
+                        "hash of function, relative debug location and block "
+                        "structure (survives rebuilds)"),
+             clEnumValN(vase::SiteIds::Sequential, "sequential",
+                        "1, 2, 3, ... in module order (old logs and maps)")),
+  cl::init(vase::SiteIds::Stable));
+
+static cl::opt<std::string> SiteManifestPath(
+  "vase-site-manifest",
+  cl::desc("Write per-function structural hashes and site ids to this file"),
+  cl::value_desc("path"), cl::init(""));
+
+static cl::opt<std::string> ChangedSince(
+  "vase-changed-since",
+  cl::desc("Only instrument branches in functions whose hash differs from "
+           "this earlier site manifest"),
+  cl::value_desc("path"), cl::init(""));
+
+static cl::opt<bool> InputOffsets(
+  "vase-input-offsets",
+  cl::desc("Record which argv/stdin/file bytes logged loads read "
+           "(loc:N:input:ARRAY:OFF:W records)"),
+  cl::init(false));
+
+static cl::opt<std::string> HotSitesPath(
+  "vase-hot-sites",
+  cl::desc("Only instrument the hottest sites of this KLEE --vase-site-stats file"),
+  cl::value_desc("path"), cl::init(""));
+
+static cl::opt<unsigned> HotTopK(
+  "vase-hot-top-k",
+  cl::desc("How many sites of -vase-hot-sites to instrument, by solver time "
+           "(0 = every site with a query)"),
+  cl::init(0));
+
+static cl::opt<bool> CallContext(
+  "vase-context",
+  cl::desc("Bracket call sites with __vase_ctx_push/pop so the logger can key "
+           "records by calling context (VASE_CTX_DEPTH)"),
+  cl::init(false));
+
+namespace {
+
+struct LoggedOperand {
+  Value *value;
+  std::string name;
+};
+
+struct LoopAnalyses {
+  LoopInfo &LI;
+  ScalarEvolution &SE;
+  DominatorTree &DT;
+  SCEVExpander expander;
+
+  LoopAnalyses(LoopInfo &LI, ScalarEvolution &SE, DominatorTree &DT,
+               const DataLayout &DL)
+      : LI(LI), SE(SE), DT(DT), expander(SE, DL, "vase") {}
+};
+
+// (start, step, count) of an affine induction variable, logged at `exit`.
+struct IVSummary {
+  BasicBlock *exit;
+  const SCEV *start;
+  int64_t step;
+  const SCEV *count;
+};
+
+class VaseInstrumentPass : public ModulePass {
+public:
+  static char ID;
+  VaseInstrumentPass() : ModulePass(ID) {}
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+  bool runOnModule(Module &M) override;
+
+private:
+  // A two-way decision: a conditional branch or a select.
+  using Site = std::pair<Instruction *, int>;
+
+  void instrumentCallSites(Function &F);
+  bool instrumentSite(Instruction *site, int locId, const vase::InputTaint *taint,
+                      LoopAnalyses *loops);
+  bool instrumentSwitch(SwitchInst *SI, int locId, const vase::InputTaint *taint);
+  void instrumentLibcCall(CallInst *CI, int locId, const vase::LibcCallSpec &spec);
+  void logInputLoads(Instruction *at, int locId,
+                     const std::vector<LoggedOperand> &operands);
+  void redirectInputReads(Function &F);
+  bool hoistSite(Instruction *site, int locId,
+                 const std::vector<LoggedOperand> &operands, Loop *L,
+                 LoopAnalyses &A);
+  void logIV(int locId, const LoggedOperand &op, const IVSummary &iv,
+             LoopAnalyses &A);
+  Value *toI32(IRBuilder<> &B, Value *V);
+  Constant *nameString(Module &M, StringRef name);
+
+  void inferStaticValues(const std::vector<Site> &sites,
+                         const vase::InputTaint *taint, LazyValueInfo &LVI,
+                         DominatorTree &DT);
+  bool writeStaticMap() const;
+  bool writeSiteManifest() const;
+
+  FunctionCallee logVar;
+  FunctionCallee logSite;
+  FunctionCallee logIVFn;
+  FunctionCallee logSwitch;
+  FunctionCallee logCall;
+  FunctionCallee logField;
+  FunctionCallee logLoad;
+  FunctionCallee inputArgs;
+  FunctionCallee ctxPush;
+  FunctionCallee ctxPop;
+  StringMap<Constant *> names;
+  StringMap<vase::LibcCallSpec> libcCalls;
+
+  std::unique_ptr<vase::StaticValueSets> staticSets;
+  // staticEntries[locId][var] = values
+  std::map<int, std::map<std::string, std::set<int64_t>>> staticEntries;
+  DenseMap<const Instruction *, SmallPtrSet<const Value *, 2>> staticOperands;
+
+  struct FunctionRecord {
+    std::string name;
+    std::string file;
+    uint32_t hash;
+    bool instrumented;
+    std::vector<int> sites;
+  };
+  std::vector<FunctionRecord> manifest;
+};
+
+} // namespace
+
+char VaseInstrumentPass::ID = 0;
+
+static RegisterPass<VaseInstrumentPass>
+    X("vase-instrument", "VASE branch operand value instrumentation", false, false);
+
+// ---- Naming ----------------------------------------------------------------
+
+static std::string debugName(Value *V) {
+  SmallVector<DbgVariableIntrinsic *, 2> users;
+  findDbgUsers(users, V);
+  for (DbgVariableIntrinsic *DVI : users)
+    if (DILocalVariable *var = DVI->getVariable())
+      if (!var->getName().empty())
+        return var->getName().str();
+  return "";
+}
+
+// Source-level name of a logged operand: the debug variable bound to it, or
+// the variable/global it was loaded from.
+static std::string operandName(Value *V, const char *fallback) {
+  std::string name = debugName(V);
+  if (!name.empty())
+    return name;
+
+  if (auto *LI = dyn_cast<LoadInst>(V)) {
+    Value *ptr = LI->getPointerOperand()->stripPointerCasts();
+    while (auto *GEP = dyn_cast<GEPOperator>(ptr))
+      ptr = GEP->getPointerOperand()->stripPointerCasts();
+    if (isa<AllocaInst>(ptr)) {
+      name = debugName(ptr);
+      if (!name.empty())
+        return name;
+    }
+    if (isa<GlobalVariable>(ptr) || isa<AllocaInst>(ptr) || isa<Argument>(ptr))
+      if (ptr->hasName())
+        return ptr->getName().str();
+  }
+
+  if (V->hasName())
+    return V->getName().str();
+  return fallback;
+}
+
+// ---- Branch instrumentation --------------------------------------------------
+
+static Value *siteCondition(Instruction *site) {
+  if (auto *BI = dyn_cast<BranchInst>(site))
+    return BI->getCondition();
+  return cast<SelectInst>(site)->getCondition();
+}
+
+// Integer values that decide `cond`: the operands of an integer compare, the
+// byte a `bool` was truncated from, or the condition itself.
+static void collectOperands(Value *cond, std::vector<LoggedOperand> &out) {
+  if (auto *IC = dyn_cast<ICmpInst>(cond)) {
+    for (Value *op : IC->operands())
+      if (!isa<Constant>(op) && op->getType()->isIntegerTy())
+        out.push_back({op, operandName(op, "condition")});
+    return;
+  }
+  if (auto *TI = dyn_cast<TruncInst>(cond)) {
+    Value *op = TI->getOperand(0);
+    if (!isa<Constant>(op))
+      out.push_back({op, operandName(op, "condition")});
+    return;
+  }
+  if (isa<Constant>(cond) || !cond->getType()->isIntegerTy())
+    return;
+  out.push_back({cond, operandName(cond, isa<PHINode>(cond) ? "phi_condition"
+                                                             : "condition")});
+}
+
+// ---- Loops -------------------------------------------------------------------
+
+// Outermost loop around BB out of which `needed` can be logged once per loop
+// entry: every level has a preheader, keeps `needed` invariant, and BB runs on
+// every trip through it (dominates all of its exiting blocks).
+static Loop *hoistTarget(BasicBlock *BB, ArrayRef<Value *> needed, Loop *L,
+                         DominatorTree &DT) {
+  Loop *target = nullptr;
+  for (; L; L = L->getParentLoop()) {
+    if (!L->getLoopPreheader())
+      break;
+    if (!all_of(needed, [&](Value *V) { return L->isLoopInvariant(V); }))
+      break;
+    SmallVector<BasicBlock *, 4> exiting;
+    L->getExitingBlocks(exiting);
+    if (!all_of(exiting, [&](BasicBlock *E) { return DT.dominates(BB, E); }))
+      break;
+    target = L;
+  }
+  return target;
+}
+
+// An operand that is an affine recurrence of L with constant step, compared on
+// every iteration, in a loop with a single dedicated exit and a computable
+// trip count.
+static bool summarizeIV(Value *op, BasicBlock *BB, Loop *L, LoopAnalyses &A,
+                        IVSummary &out) {
+  auto *AR = dyn_cast<SCEVAddRecExpr>(A.SE.getSCEV(op));
+  if (!AR || AR->getLoop() != L || !AR->isAffine())
+    return false;
+  auto *step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(A.SE));
+  if (!step || step->getValue()->isZero())
+    return false;
+
+  BasicBlock *exit = L->getExitBlock();
+  BasicBlock *latch = L->getLoopLatch();
+  if (!exit || !latch || !L->hasDedicatedExits() || !A.DT.dominates(BB, latch))
+    return false;
+
+  const SCEV *btc = A.SE.getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(btc))
+    return false;
+  Instruction *at = &*exit->getFirstInsertionPt();
+  if (!isSafeToExpandAt(AR->getStart(), at, A.SE) || !isSafeToExpandAt(btc, at, A.SE))
+    return false;
+
+  out.exit = exit;
+  out.start = AR->getStart();
+  out.step = step->getAPInt().getSExtValue();
+  out.count = A.SE.getAddExpr(btc, A.SE.getOne(btc->getType()));
+  return true;
+}
+
+// Whole-site hoist: when the condition is invariant too, compute it and log
+// every operand once in the preheader of the outermost loop it is invariant in.
+bool VaseInstrumentPass::hoistSite(Instruction *site, int locId,
+                                   const std::vector<LoggedOperand> &operands,
+                                   Loop *L, LoopAnalyses &A) {
+  Value *cond = siteCondition(site);
+  auto *condInst = dyn_cast<Instruction>(cond);
+  SmallVector<Value *, 2> needed;
+  if (condInst && L->contains(condInst) &&
+      (isa<ICmpInst>(condInst) || isa<TruncInst>(condInst)))
+    needed.append(condInst->op_begin(), condInst->op_end());
+  else
+    needed.push_back(cond);
+
+  Loop *H = hoistTarget(site->getParent(), needed, L, A.DT);
+  if (!H)
+    return false;
+
+  Instruction *at = H->getLoopPreheader()->getTerminator();
+  Value *condAt = cond;
+  if (condInst && H->contains(condInst)) {
+    Instruction *clone = condInst->clone();
+    clone->insertBefore(at);
+    condAt = clone;
+  }
+
+  IRBuilder<> B(at);
+  Module &M = *site->getModule();
+  Value *taken = B.CreateSelect(condAt, B.getInt32(0), B.getInt32(1));
+  for (const LoggedOperand &op : operands)
+    B.CreateCall(logVar, {B.getInt32(locId), taken, nameString(M, op.name),
+                          toI32(B, op.value)});
+  ++NumSitesHoisted;
+  return true;
+}
+
+void VaseInstrumentPass::logIV(int locId, const LoggedOperand &op,
+                               const IVSummary &iv, LoopAnalyses &A) {
+  Instruction *at = &*iv.exit->getFirstInsertionPt();
+  Value *start = A.expander.expandCodeFor(iv.start, iv.start->getType(), at);
+  Value *count = A.expander.expandCodeFor(iv.count, iv.count->getType(), at);
+  IRBuilder<> B(at);
+  B.CreateCall(logIVFn, {B.getInt32(locId), nameString(*at->getModule(), op.name),
+                         toI32(B, start), B.getInt32((int32_t)iv.step),
+                         toI32(B, count)});
+  ++NumIVSummaries;
+}
+
+Constant *VaseInstrumentPass::nameString(Module &M, StringRef name) {
+  auto it = names.find(name);
+  if (it != names.end())
+    return it->second;
+  Constant *init = ConstantDataArray::getString(M.getContext(), name);
+  auto *GV = new GlobalVariable(M, init->getType(), true,
+                                GlobalValue::PrivateLinkage, init, ".vase.var");
+  GV->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+  Constant *ptr = ConstantExpr::getPointerCast(GV, Type::getInt8PtrTy(M.getContext()));
+  names[name] = ptr;
+  return ptr;
+}
+
+Value *VaseInstrumentPass::toI32(IRBuilder<> &B, Value *V) {
+  return V->getType()->isIntegerTy(1) ? B.CreateZExt(V, B.getInt32Ty())
+                                      : B.CreateSExtOrTrunc(V, B.getInt32Ty());
+}
+
+// Branches and selects: log each input-dependent operand of the condition
+// with the successor / arm taken (0 = true, 1 = false).
+bool VaseInstrumentPass::instrumentSite(Instruction *site, int locId,
+                                        const vase::InputTaint *taint,
+                                        LoopAnalyses *loops) {
+  Value *cond = siteCondition(site);
+  std::vector<LoggedOperand> candidates, operands;
+  collectOperands(cond, candidates);
+  auto covered = staticOperands.find(site);
+  for (const LoggedOperand &op : candidates) {
+    if (taint && !taint->isTainted(op.value))
+      ++NumOperandsFiltered;
+    else if (covered == staticOperands.end() || !covered->second.count(op.value))
+      operands.push_back(op);
+  }
+  if (operands.empty())
+    return false;
+  if (InputOffsets)
+    logInputLoads(site, locId, operands);
+
+  Module &M = *site->getModule();
+  BasicBlock *BB = site->getParent();
+  Loop *L = loops ? loops->LI.getLoopFor(BB) : nullptr;
+  if (L && hoistSite(site, locId, operands, L, *loops))
+    return true;
+
+  IRBuilder<> B(site);
+  Value *taken = nullptr;
+  for (const LoggedOperand &op : operands) {
+    if (L) {
+      IVSummary iv;
+      if (summarizeIV(op.value, BB, L, *loops, iv)) {
+        logIV(locId, op, iv, *loops);
+        continue;
+      }
+      if (Loop *H = hoistTarget(BB, {op.value}, L, loops->DT)) {
+        IRBuilder<> P(H->getLoopPreheader()->getTerminator());
+        P.CreateCall(logSite, {P.getInt32(locId), nameString(M, op.name),
+                               toI32(P, op.value)});
+        ++NumOperandsHoisted;
+        continue;
+      }
+    }
+    if (!taken)
+      taken = B.CreateSelect(cond, B.getInt32(0), B.getInt32(1));
+    B.CreateCall(logVar, {B.getInt32(locId), taken, nameString(M, op.name),
+                          toI32(B, op.value)});
+  }
+  return true;
+}
+
+// Switches: the logger maps the discriminant to its case index (1-based in
+// case order, 0 = default), so records read loc:N:branch:K like branches do.
+bool VaseInstrumentPass::instrumentSwitch(SwitchInst *SI, int locId,
+                                          const vase::InputTaint *taint) {
+  Value *cond = SI->getCondition();
+  if (isa<Constant>(cond))
+    return false;
+  if (taint && !taint->isTainted(cond)) {
+    ++NumOperandsFiltered;
+    return false;
+  }
+
+  Module &M = *SI->getModule();
+  std::string name = operandName(cond, "switch_condition");
+  if (InputOffsets)
+    logInputLoads(SI, locId, {{cond, name}});
+
+  IRBuilder<> B(SI);
+  SmallVector<Constant *, 16> cases;
+  for (auto &Case : SI->cases())
+    cases.push_back(B.getInt32((int32_t)Case.getCaseValue()->getSExtValue()));
+  auto *tableTy = ArrayType::get(B.getInt32Ty(), cases.size());
+  auto *table = new GlobalVariable(M, tableTy, true, GlobalValue::PrivateLinkage,
+                                   ConstantArray::get(tableTy, cases),
+                                   ".vase.cases");
+  table->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+
+  B.CreateCall(logSwitch,
+               {B.getInt32(locId), nameString(M, name),
+                toI32(B, cond), B.CreatePointerCast(table, B.getInt32Ty()->getPointerTo()),
+                B.getInt32(cases.size())});
+  return true;
+}
+
+// Libc boundary values: logged after the call as branchless loc:N records.
+void VaseInstrumentPass::instrumentLibcCall(CallInst *CI, int locId,
+                                            const vase::LibcCallSpec &spec) {
+  Module &M = *CI->getModule();
+  StringRef function = CI->getCalledFunction()->getName();
+  IRBuilder<> B(CI->getNextNode());
+
+  Value *status = B.getInt64(0);
+  if (CI->getType()->isIntegerTy()) {
+    // Whole, not toI32: read() returns ssize_t. IR integers are signless, so
+    // the callee's zeroext return attribute says how to widen.
+    status = CI->getType()->isIntegerTy(1) || CI->hasRetAttr(Attribute::ZExt)
+                 ? B.CreateZExtOrTrunc(CI, B.getInt64Ty())
+                 : B.CreateSExtOrTrunc(CI, B.getInt64Ty());
+    B.CreateCall(logCall, {B.getInt32(locId), nameString(M, function), status});
+  }
+  for (const vase::LibcField &field : spec.fields) {
+    if (field.arg >= CI->arg_size() ||
+        !CI->getArgOperand(field.arg)->getType()->isPointerTy())
+      continue;
+    Value *base = B.CreatePointerCast(CI->getArgOperand(field.arg), B.getInt8PtrTy());
+    Value *addr = B.CreateConstGEP1_32(B.getInt8Ty(), base, field.offset);
+    B.CreateCall(logField, {B.getInt32(locId), nameString(M, field.name), addr,
+                            B.getInt32(field.width), status});
+  }
+}
+
+// ---- Input offsets -----------------------------------------------------------
+
+// The load a logged operand is (an integer cast of), if any.
+static LoadInst *loadedFrom(Value *V) {
+  while (isa<ZExtInst>(V) || isa<SExtInst>(V) || isa<TruncInst>(V))
+    V = cast<Instruction>(V)->getOperand(0);
+  auto *LI = dyn_cast<LoadInst>(V);
+  return LI && LI->getType()->isIntegerTy() ? LI : nullptr;
+}
+
+// Per-iteration, even where hoisting moved the value records out of a loop:
+// each iteration may read a different input byte.
+void VaseInstrumentPass::logInputLoads(Instruction *at, int locId,
+                                       const std::vector<LoggedOperand> &operands) {
+  Module &M = *at->getModule();
+  const DataLayout &DL = M.getDataLayout();
+  IRBuilder<> B(at);
+  for (const LoggedOperand &op : operands) {
+    LoadInst *LI = loadedFrom(op.value);
+    if (!LI)
+      continue;
+    uint64_t width = DL.getTypeStoreSize(LI->getType());
+    if (width != 1 && width != 2 && width != 4 && width != 8)
+      continue;
+    // All `width` bytes: a loc:N:arr:NAME:OFF:8 entry pins every one of them
+    Value *value = LI->getType()->isIntegerTy(1) ? B.CreateZExt(LI, B.getInt64Ty())
+                                                 : B.CreateSExt(LI, B.getInt64Ty());
+    B.CreateCall(logLoad, {B.getInt32(locId), nameString(M, op.name),
+                           B.CreatePointerCast(LI->getPointerOperand(), B.getInt8PtrTy()),
+                           B.getInt32((int32_t)width), value});
+    ++NumInputLoads;
+  }
+}
+
+// Calls whose buffers the logger must know about, and main's argv.
+void VaseInstrumentPass::redirectInputReads(Function &F) {
+  static const char *const reads[] = {"read", "pread", "pread64", "fread", "fgets"};
+  Module &M = *F.getParent();
+  for (Instruction &I : instructions(F)) {
+    auto *CI = dyn_cast<CallInst>(&I);
+    Function *callee = CI ? CI->getCalledFunction() : nullptr;
+    if (!callee || !is_contained(reads, callee->getName()))
+      continue;
+    FunctionCallee wrapper = M.getOrInsertFunction(
+        ("__vase_" + callee->getName()).str(), callee->getFunctionType());
+    CI->setCalledFunction(wrapper);
+    ++NumInputReads;
+  }
+
+  if (F.getName() == "main" && F.arg_size() >= 2) {
+    IRBuilder<> B(&*F.getEntryBlock().getFirstInsertionPt());
+    Argument *argc = &*F.arg_begin(), *argv = &*std::next(F.arg_begin());
+    if (argc->getType()->isIntegerTy() && argv->getType()->isPointerTy())
+      B.CreateCall(inputArgs,
+                   {B.CreateSExtOrTrunc(argc, B.getInt32Ty()),
+                    B.CreatePointerCast(argv, inputArgs.getFunctionType()->getParamType(1))});
+  }
+}
+
+// ---- Calling context ---------------------------------------------------------
+
+// FNV-1a over the function name followed by the little-endian bytes of the
+// call's ordinal within that function, counted before any call is redirected.
+static uint32_t callSiteId(StringRef function, uint32_t ordinal) {
+  return vase::fnvU32(vase::fnvBytes(vase::FnvOffset, function), ordinal);
+}
+
+static bool isRuntimeOrIntrinsic(const CallBase *CB) {
+  const Function *callee = CB->getCalledFunction();
+  return callee && (callee->isIntrinsic() || callee->getName().startswith("__vase_"));
+}
+
+void VaseInstrumentPass::instrumentCallSites(Function &F) {
+  std::vector<std::pair<CallInst *, uint32_t>> calls;
+  uint32_t ordinal = 0;
+  for (Instruction &I : instructions(F)) {
+    auto *CB = dyn_cast<CallBase>(&I);
+    if (!CB || isRuntimeOrIntrinsic(CB))
+      continue;
+    uint32_t id = callSiteId(F.getName(), ordinal++);
+    // Invokes keep their ordinal but are not bracketed (C code has none).
+    if (auto *CI = dyn_cast<CallInst>(CB))
+      if (!CI->isMustTailCall())
+        calls.emplace_back(CI, id);
+  }
+
+  for (auto &entry : calls) {
+    IRBuilder<> B(entry.first);
+    B.CreateCall(ctxPush, {B.getInt32(entry.second)});
+    B.SetInsertPoint(entry.first->getNextNode());
+    B.CreateCall(ctxPop, {});
+    ++NumCallSites;
+  }
+}
+
+// ---- Static value sets -------------------------------------------------------
+
+// Runs before any instrumentation of the function, so LVI sees the original IR.
+void VaseInstrumentPass::inferStaticValues(const std::vector<Site> &sites,
+                                           const vase::InputTaint *taint,
+                                           LazyValueInfo &LVI, DominatorTree &DT) {
+  for (auto &entry : sites) {
+    Instruction *site = entry.first;
+    std::vector<LoggedOperand> candidates;
+    collectOperands(siteCondition(site), candidates);
+    bool allCovered = !candidates.empty();
+    for (const LoggedOperand &op : candidates) {
+      if (taint && !taint->isTainted(op.value))
+        continue;
+      std::vector<int64_t> values;
+      if (!staticSets->valuesAt(op.value, site, &LVI, &DT, values)) {
+        allCovered = false;
+        continue;
+      }
+      staticEntries[entry.second][op.name].insert(values.begin(), values.end());
+      if (StaticSkip)
+        staticOperands[site].insert(op.value);
+      ++NumOperandsStatic;
+    }
+    if (allCovered)
+      ++NumSitesStatic;
+  }
+}
+
+bool VaseInstrumentPass::writeStaticMap() const {
+  std::error_code EC;
+  raw_fd_ostream OS(StaticMapPath, EC, sys::fs::OF_Text);
+  if (EC) {
+    errs() << "vase-instrument: cannot write " << StaticMapPath << ": "
+           << EC.message() << "\n";
+    return false;
+  }
+  json::OStream J(OS, 2);
+  J.object([&] {
+    for (auto &site : staticEntries) {
+      J.attributeObject("loc:" + std::to_string(site.first), [&] {
+        for (auto &var : site.second) {
+          J.attributeArray(var.first, [&] {
+            for (int64_t v : var.second)
+              J.object([&] {
+                J.attribute("type", 0);
+                J.attribute("value", std::to_string(v));
+                J.attribute("static", true);
+              });
+          });
+        }
+      });
+    }
+  });
+  OS << "\n";
+  return true;
+}
+
+// ---- Site manifest -----------------------------------------------------------
+
+static std::string hex32(uint32_t v) {
+  char buf[9];
+  snprintf(buf, sizeof(buf), "%08x", v);
+  return buf;
+}
+
+// Function name -> structural hash from an earlier -vase-site-manifest.
+static bool readManifestHashes(StringRef path, StringMap<uint32_t> &out) {
+  auto buf = MemoryBuffer::getFile(path);
+  if (!buf) {
+    errs() << "vase-instrument: cannot read " << path << ": "
+           << buf.getError().message() << "\n";
+    return false;
+  }
+  Expected<json::Value> root = json::parse((*buf)->getBuffer());
+  if (!root) {
+    errs() << "vase-instrument: " << path << ": " << toString(root.takeError())
+           << "\n";
+    return false;
+  }
+  const json::Object *obj = root->getAsObject();
+  const json::Object *functions = obj ? obj->getObject("functions") : nullptr;
+  if (!functions) {
+    errs() << "vase-instrument: " << path << ": no \"functions\" object\n";
+    return false;
+  }
+  for (const auto &entry : *functions) {
+    const json::Object *fn = entry.second.getAsObject();
+    if (!fn)
+      continue;
+    if (auto hash = fn->getString("hash"))
+      out[StringRef(entry.first)] = (uint32_t)strtoul(hash->str().c_str(), nullptr, 16);
+  }
+  return true;
+}
+
+bool VaseInstrumentPass::writeSiteManifest() const {
+  std::error_code EC;
+  raw_fd_ostream OS(SiteManifestPath, EC, sys::fs::OF_Text);
+  if (EC) {
+    errs() << "vase-instrument: cannot write " << SiteManifestPath << ": "
+           << EC.message() << "\n";
+    return false;
+  }
+  json::OStream J(OS, 2);
+  J.object([&] {
+    J.attribute("site_ids", SiteIdScheme == vase::SiteIds::Stable ? "stable"
+                                                                  : "sequential");
+    J.attributeObject("functions", [&] {
+      for (const FunctionRecord &fn : manifest) {
+        J.attributeObject(fn.name, [&] {
+          J.attribute("hash", hex32(fn.hash));
+          J.attribute("file", fn.file);
+          J.attribute("instrumented", fn.instrumented);
+          J.attributeArray("sites", [&] {
+            for (int id : fn.sites)
+              J.value(id);
+          });
+        });
+      }
+    });
+  });
+  OS << "\n";
+  return true;
+}
+
+// ---- Hot sites -----------------------------------------------------------------
+
+// Site ids of the topK entries of a --vase-site-stats file, ranked by solver
+// time, then query count. False (no filter) when no query was attributed to
+// a site: stats of bitcode without site ids only have loc:0.
+static bool readHotSites(StringRef path, unsigned topK, DenseSet<int> &out) {
+  auto buf = MemoryBuffer::getFile(path);
+  if (!buf) {
+    errs() << "vase-instrument: cannot read " << path << ": "
+           << buf.getError().message() << "\n";
+    return false;
+  }
+  Expected<json::Value> root = json::parse((*buf)->getBuffer());
+  if (!root) {
+    errs() << "vase-instrument: " << path << ": " << toString(root.takeError())
+           << "\n";
+    return false;
+  }
+  const json::Object *obj = root->getAsObject();
+  if (!obj) {
+    errs() << "vase-instrument: " << path << ": expected an object\n";
+    return false;
+  }
+
+  struct Hot {
+    int id;
+    int64_t micros, queries;
+  };
+  std::vector<Hot> ranked;
+  for (const auto &entry : *obj) {
+    StringRef key(entry.first);
+    int id;
+    const json::Object *stats = entry.second.getAsObject();
+    if (!stats || !key.consume_front("loc:") || key.getAsInteger(10, id) || id <= 0)
+      continue;
+    ranked.push_back({id, stats->getInteger("solver_us").getValueOr(0),
+                      stats->getInteger("queries").getValueOr(0)});
+  }
+  std::sort(ranked.begin(), ranked.end(), [](const Hot &a, const Hot &b) {
+    if (a.micros != b.micros)
+      return a.micros > b.micros;
+    if (a.queries != b.queries)
+      return a.queries > b.queries;
+    return a.id < b.id;
+  });
+  if (ranked.empty()) {
+    errs() << "vase-instrument: " << path
+           << ": no site has queries, instrumenting every site\n";
+    return false;
+  }
+  if (topK && ranked.size() > topK)
+    ranked.resize(topK);
+  for (const Hot &h : ranked)
+    out.insert(h.id);
+  return true;
+}
+
+// ---- Driver ------------------------------------------------------------------
+
+void VaseInstrumentPass::getAnalysisUsage(AnalysisUsage &AU) const {
+  if (LoopHoist) {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+  }
+  if (!StaticMapPath.empty()) {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LazyValueInfoWrapperPass>();
+  }
+}
+
+bool VaseInstrumentPass::runOnModule(Module &M) {
+  LLVMContext &C = M.getContext();
+  Type *i32 = Type::getInt32Ty(C);
+  logVar = M.getOrInsertFunction("__vase_log_var", Type::getVoidTy(C), i32, i32,
+                                 Type::getInt8PtrTy(C), i32);
+  logSite = M.getOrInsertFunction("__vase_log_site", Type::getVoidTy(C), i32,
+                                  Type::getInt8PtrTy(C), i32);
+  logIVFn = M.getOrInsertFunction("__vase_log_iv", Type::getVoidTy(C), i32,
+                                  Type::getInt8PtrTy(C), i32, i32, i32);
+  logSwitch = M.getOrInsertFunction("__vase_log_switch", Type::getVoidTy(C), i32,
+                                    Type::getInt8PtrTy(C), i32,
+                                    i32->getPointerTo(), i32);
+  logCall = M.getOrInsertFunction("__vase_log_call", Type::getVoidTy(C), i32,
+                                  Type::getInt8PtrTy(C), Type::getInt64Ty(C));
+  logField = M.getOrInsertFunction("__vase_log_field", Type::getVoidTy(C), i32,
+                                   Type::getInt8PtrTy(C), Type::getInt8PtrTy(C),
+                                   i32, Type::getInt64Ty(C));
+  logLoad = M.getOrInsertFunction("__vase_log_load", Type::getVoidTy(C), i32,
+                                  Type::getInt8PtrTy(C), Type::getInt8PtrTy(C),
+                                  i32, Type::getInt64Ty(C));
+  inputArgs = M.getOrInsertFunction("__vase_input_args", Type::getVoidTy(C), i32,
+                                    Type::getInt8PtrTy(C)->getPointerTo());
+  ctxPush = M.getOrInsertFunction("__vase_ctx_push", Type::getVoidTy(C), i32);
+  ctxPop = M.getOrInsertFunction("__vase_ctx_pop", Type::getVoidTy(C));
+
+  std::unique_ptr<vase::InputTaint> taint;
+  if (TaintFilter) {
+    taint.reset(new vase::InputTaint(M, std::vector<std::string>(
+                                            ExtraInputFuncs.begin(),
+                                            ExtraInputFuncs.end())));
+    taint->run();
+  }
+  if (!StaticMapPath.empty())
+    staticSets.reset(new vase::StaticValueSets(M, StaticMaxValues));
+
+  std::string specError;
+  if (!vase::parseLibcCallSpecs(std::vector<std::string>(LibcCalls.begin(),
+                                                         LibcCalls.end()),
+                                libcCalls, specError))
+    report_fatal_error(Twine("-vase-libc-calls: ") + specError);
+
+  StringMap<uint32_t> oldHashes;
+  bool incremental = !ChangedSince.empty() && readManifestHashes(ChangedSince, oldHashes);
+  bool hashFunctions = incremental || !SiteManifestPath.empty();
+
+  DenseSet<int> hotSites;
+  bool hotOnly = !HotSitesPath.empty() && readHotSites(HotSitesPath, HotTopK, hotSites);
+  auto isCold = [&](int id) {
+    if (!hotOnly || hotSites.count(id))
+      return false;
+    ++NumSitesCold;
+    return true;
+  };
+
+  // Every site gets an id, instrumented or not, so filtering never renumbers
+  // the remaining ones. Switches, selects and libc calls are numbered after
+  // all branches so that sequential branch ids match logs from before they
+  // were profiled.
+  struct FunctionSites {
+    Function *F;
+    std::vector<Site> sites; // branches, then selects
+    std::vector<std::pair<SwitchInst *, int>> switches;
+    std::vector<std::pair<CallInst *, int>> libcCalls;
+  };
+  std::vector<FunctionSites> functions;
+  vase::SiteIds ids(SiteIdScheme);
+  for (Function &F : M) {
+    if (F.isDeclaration() || F.getName().startswith("__vase_"))
+      continue;
+    functions.push_back({&F, {}, {}, {}});
+    ids.beginFunction(F);
+    for (BasicBlock &BB : F)
+      if (auto *BI = dyn_cast<BranchInst>(BB.getTerminator()))
+        if (BI->isConditional())
+          functions.back().sites.emplace_back(BI, ids.next(*BI));
+    NumSites += functions.back().sites.size();
+  }
+  for (FunctionSites &fs : functions) {
+    ids.beginFunction(*fs.F);
+    for (Instruction &I : instructions(*fs.F)) {
+      if (auto *SI = dyn_cast<SwitchInst>(&I)) {
+        if (ProfileSwitches && SI->getNumCases() > 0) {
+          fs.switches.emplace_back(SI, ids.next(*SI));
+          ++NumSwitchSites;
+        }
+      } else if (auto *Sel = dyn_cast<SelectInst>(&I)) {
+        if (ProfileSelects && Sel->getCondition()->getType()->isIntegerTy(1)) {
+          fs.sites.emplace_back(Sel, ids.next(*Sel));
+          ++NumSelectSites;
+        }
+      }
+    }
+  }
+  if (!libcCalls.empty()) {
+    for (FunctionSites &fs : functions) {
+      ids.beginFunction(*fs.F);
+      for (Instruction &I : instructions(*fs.F)) {
+        auto *CI = dyn_cast<CallInst>(&I);
+        Function *callee = CI ? CI->getCalledFunction() : nullptr;
+        if (callee && libcCalls.count(callee->getName())) {
+          fs.libcCalls.emplace_back(CI, ids.next(*CI));
+          ++NumLibcSites;
+        }
+      }
+    }
+  }
+
+  bool changed = false;
+  for (FunctionSites &fs : functions) {
+    Function &F = *fs.F;
+
+    uint32_t hash = hashFunctions ? vase::functionHash(F) : 0;
+    bool unchanged = false;
+    if (incremental) {
+      auto it = oldHashes.find(F.getName());
+      unchanged = it != oldHashes.end() && it->second == hash;
+      if (unchanged)
+        ++NumFunctionsUnchanged;
+    }
+    if (!SiteManifestPath.empty()) {
+      const DISubprogram *SP = F.getSubprogram();
+      FunctionRecord record{F.getName().str(), SP ? SP->getFilename().str() : "",
+                            hash, !unchanged, {}};
+      for (auto &entry : fs.sites)
+        record.sites.push_back(entry.second);
+      for (auto &entry : fs.switches)
+        record.sites.push_back(entry.second);
+      for (auto &entry : fs.libcCalls)
+        record.sites.push_back(entry.second);
+      manifest.push_back(std::move(record));
+    }
+
+    // Every getAnalysis<>(F) of a module pass reruns all on-the-fly function
+    // passes of F, and ScalarEvolutionWrapperPass and LazyValueInfoWrapperPass
+    // release their results before they do: fetch those last.
+    if (staticSets && !fs.sites.empty()) {
+      auto &DT = getAnalysis<DominatorTreeWrapperPass>(F).getDomTree();
+      auto &LVI = getAnalysis<LazyValueInfoWrapperPass>(F).getLVI();
+      inferStaticValues(fs.sites, taint.get(), LVI, DT);
+    }
+
+    if (!unchanged) {
+      std::unique_ptr<LoopAnalyses> loops;
+      if (LoopHoist && !fs.sites.empty()) {
+        auto &LI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+        auto &DT = getAnalysis<DominatorTreeWrapperPass>(F).getDomTree();
+        auto &SE = getAnalysis<ScalarEvolutionWrapperPass>(F).getSE();
+        loops.reset(new LoopAnalyses(LI, SE, DT, M.getDataLayout()));
+      }
+
+      for (auto &entry : fs.sites) {
+        if (isCold(entry.second))
+          continue;
+        if (instrumentSite(entry.first, entry.second, taint.get(), loops.get())) {
+          ++NumSitesInstrumented;
+          changed = true;
+        }
+      }
+      for (auto &entry : fs.switches) {
+        if (isCold(entry.second))
+          continue;
+        if (instrumentSwitch(entry.first, entry.second, taint.get())) {
+          ++NumSitesInstrumented;
+          changed = true;
+        }
+      }
+      for (auto &entry : fs.libcCalls) {
+        if (isCold(entry.second))
+          continue;
+        Function *callee = entry.first->getCalledFunction();
+        instrumentLibcCall(entry.first, entry.second,
+                           libcCalls.find(callee->getName())->second);
+        changed = true;
+      }
+    }
+
+    // Before redirectInputReads: the __vase_ wrappers it substitutes would
+    // otherwise drop out of the call-site ordinals.
+    if (CallContext) {
+      instrumentCallSites(F);
+      changed = true;
+    }
+
+    // Unchanged functions still read input other code may compare.
+    if (InputOffsets) {
+      redirectInputReads(F);
+      changed = true;
+    }
+  }
+
+  if (staticSets)
+    writeStaticMap();
+  if (!SiteManifestPath.empty())
+    writeSiteManifest();
+  return changed;
+}
@@ -0,0 +1,79 @@
+// VaseLibcCalls.cpp — -vase-libc-calls spec parsing (see VaseLibcCalls.h)
+
+#include "VaseLibcCalls.h"
+
+#include "llvm/ADT/Twine.h"
+
+using namespace llvm;
+
+namespace vase {
+
+// The calls KLEE's POSIX runtime backs with symbolic data that coreutils
+// branches on most. Terminated by nullptr.
+const char *const DefaultLibcCalls[] = {
+  "read", "pread", "pread64", "fread",
+  "getopt", "getopt_long", "getopt_long_only",
+  "getc", "fgetc", "getchar", "getc_unlocked", "getchar_unlocked",
+  "open", "open64", "openat", "access", "isatty", "readlink",
+  "stat:1@24:4=st_mode", "lstat:1@24:4=st_mode", "fstat:1@24:4=st_mode",
+  "stat64:1@24:4=st_mode", "lstat64:1@24:4=st_mode", "fstat64:1@24:4=st_mode",
+  "fstatat:2@24:4=st_mode",
+  "__xstat:2@24:4=st_mode", "__lxstat:2@24:4=st_mode", "__fxstat:2@24:4=st_mode",
+  "__xstat64:2@24:4=st_mode", "__lxstat64:2@24:4=st_mode",
+  "__fxstat64:2@24:4=st_mode", "__fxstatat:3@24:4=st_mode",
+  nullptr,
+};
+
+static bool parseField(StringRef function, StringRef text, LibcField &field,
+                       std::string &error) {
+  // ARG@OFF:WIDTH[=alias]
+  StringRef alias;
+  std::tie(text, alias) = text.split('=');
+  StringRef arg, rest, offset, width;
+  std::tie(arg, rest) = text.split('@');
+  std::tie(offset, width) = rest.split(':');
+  if (arg.getAsInteger(10, field.arg) || offset.getAsInteger(10, field.offset) ||
+      width.getAsInteger(10, field.width)) {
+    error = "expected ARG@OFF:WIDTH after '" + function.str() + ":', got '" +
+            text.str() + "'";
+    return false;
+  }
+  if (field.width != 1 && field.width != 2 && field.width != 4 && field.width != 8) {
+    error = "field width must be 1, 2, 4 or 8 in '" + text.str() + "'";
+    return false;
+  }
+  field.name = alias.empty() ? (Twine(function) + "." + arg + "@" + offset).str()
+                             : alias.str();
+  return true;
+}
+
+bool parseLibcCallSpecs(const std::vector<std::string> &specs,
+                        StringMap<LibcCallSpec> &out, std::string &error) {
+  for (const std::string &spec : specs) {
+    if (spec == "default") {
+      std::vector<std::string> defaults;
+      for (const char *const *d = DefaultLibcCalls; *d; ++d)
+        defaults.push_back(*d);
+      if (!parseLibcCallSpecs(defaults, out, error))
+        return false;
+      continue;
+    }
+
+    StringRef function, fieldText;
+    std::tie(function, fieldText) = StringRef(spec).split(':');
+    if (function.empty()) {
+      error = "empty function name in '" + spec + "'";
+      return false;
+    }
+    LibcCallSpec &entry = out[function];
+    if (fieldText.empty())
+      continue;
+    LibcField field;
+    if (!parseField(function, fieldText, field, error))
+      return false;
+    entry.fields.push_back(field);
+  }
+  return true;
+}
+
+} // namespace vase
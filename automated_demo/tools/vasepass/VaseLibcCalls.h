@@ -0,0 +1,48 @@
+// VaseLibcCalls.h — which libc call results the VASE pass profiles
+//
+// KLEE's POSIX runtime makes the results of read/stat/getopt_long/… symbolic,
+// and those values drive most of coreutils' control flow. With
+// -vase-libc-calls the pass logs, right after each direct call to a listed
+// function, its integer return value (plus errno when it is negative) and
+// any listed out-parameter fields, as branchless loc:N records.
+//
+// Spec syntax, one per list element:
+//   name                       return value only
+//   name:ARG@OFF:WIDTH[=alias] also the WIDTH-byte field at byte OFF of the
+//                              object pointed to by argument ARG (0-based),
+//                              logged as `alias` (default name.ARG@OFF)
+// Repeating a name adds fields. `default` expands to DefaultLibcCalls, which
+// assumes x86-64 glibc struct layouts (st_mode at offset 24).
+
+#ifndef VASE_LIBC_CALLS_H
+#define VASE_LIBC_CALLS_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <vector>
+
+namespace vase {
+
+struct LibcField {
+  unsigned arg;
+  unsigned offset;
+  unsigned width; // 1, 2, 4 or 8
+  std::string name;
+};
+
+struct LibcCallSpec {
+  std::vector<LibcField> fields;
+};
+
+extern const char *const DefaultLibcCalls[];
+
+/// Parse `specs` into `out` (keyed by function name). On a malformed spec,
+/// returns false with a message in `error`.
+bool parseLibcCallSpecs(const std::vector<std::string> &specs,
+                        llvm::StringMap<LibcCallSpec> &out, std::string &error);
+
+} // namespace vase
+
+#endif // VASE_LIBC_CALLS_H
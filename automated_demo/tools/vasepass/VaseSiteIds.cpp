@@ -0,0 +1,129 @@
+// VaseSiteIds.cpp — stable site ids (see VaseSiteIds.h)
+
+#include "VaseSiteIds.h"
+#include "VaseHash.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+#include <utility>
+
+using namespace llvm;
+
+namespace vase {
+
+// Line relative to the function's own first line, so edits elsewhere in the
+// file do not move it; column as is.
+static std::pair<uint32_t, uint32_t> relativeLoc(const Instruction &I) {
+  const DebugLoc &DL = I.getDebugLoc();
+  if (!DL)
+    return {0, 0};
+  unsigned base = 0;
+  if (const DISubprogram *SP = I.getFunction()->getSubprogram())
+    base = SP->getLine();
+  return {DL.getLine() - base, DL.getCol()};
+}
+
+static bool ignoredForHash(const Instruction &I) {
+  if (isa<DbgInfoIntrinsic>(I))
+    return true;
+  if (auto *CB = dyn_cast<CallBase>(&I))
+    if (const Function *callee = CB->getCalledFunction())
+      return callee->getName().startswith("__vase_");
+  return false;
+}
+
+// `numbering` gives local values a position-independent number within the
+// function; without it only their presence is hashed.
+static uint32_t hashInstruction(uint32_t h, const Instruction &I,
+                                const DenseMap<const Value *, uint32_t> *numbering) {
+  h = fnvU32(h, I.getOpcode());
+  h = fnvU32(h, I.getType()->getTypeID());
+  if (auto *IT = dyn_cast<IntegerType>(I.getType()))
+    h = fnvU32(h, IT->getBitWidth());
+  h = fnvU32(h, I.getNumOperands());
+  if (auto *C = dyn_cast<CmpInst>(&I))
+    h = fnvU32(h, C->getPredicate());
+  for (const Value *op : I.operands()) {
+    if (auto *CI = dyn_cast<ConstantInt>(op)) {
+      h = fnvU32(h, (uint32_t)CI->getValue().getLimitedValue());
+    } else if (auto *GV = dyn_cast<GlobalValue>(op)) {
+      h = fnvBytes(h, GV->getName());
+    } else if (numbering) {
+      auto it = numbering->find(op);
+      h = fnvU32(h, it != numbering->end() ? it->second : 0);
+    }
+  }
+  return h;
+}
+
+uint32_t functionHash(const Function &F) {
+  DenseMap<const Value *, uint32_t> numbering;
+  uint32_t n = 0;
+  for (const Argument &A : F.args())
+    numbering[&A] = ++n;
+  for (const BasicBlock &BB : F) {
+    numbering[&BB] = ++n;
+    for (const Instruction &I : BB)
+      if (!ignoredForHash(I))
+        numbering[&I] = ++n;
+  }
+
+  uint32_t h = fnvU32(FnvOffset, F.arg_size());
+  for (const Instruction &I : instructions(F)) {
+    if (ignoredForHash(I))
+      continue;
+    h = hashInstruction(h, I, &numbering);
+    auto loc = relativeLoc(I);
+    h = fnvU32(fnvU32(h, loc.first), loc.second);
+  }
+  return h;
+}
+
+void SiteIds::beginFunction(const Function &) { ordinals.clear(); }
+
+// Position of I among the hashed instructions of its function.
+static uint32_t instructionOrdinal(const Instruction &I) {
+  uint32_t n = 0;
+  for (const Instruction &J : instructions(*I.getFunction())) {
+    if (&J == &I)
+      break;
+    if (!ignoredForHash(J))
+      ++n;
+  }
+  return n;
+}
+
+int SiteIds::next(const Instruction &site) {
+  if (scheme == Sequential)
+    return nextSequential++;
+
+  uint32_t h = fnvBytes(FnvOffset, site.getFunction()->getName());
+  auto loc = relativeLoc(site);
+  h = fnvU32(fnvU32(h, loc.first), loc.second);
+  if (!isa<BranchInst>(site)) // branch ids predate the other kinds
+    h = fnvU32(h, site.getOpcode());
+  for (const Instruction &I : *site.getParent())
+    if (!ignoredForHash(I))
+      h = hashInstruction(h, I, nullptr);
+  h = fnvU32(h, ordinals[h]++);
+
+  // A collision (rare) moves the later site to an id keyed by that site
+  // alone, its function name and instruction ordinal: the ids handed out
+  // before it, and so the order functions are visited in, do not enter it.
+  uint32_t id = h & 0x7fffffffu;
+  if (id == 0 || used.count(id)) {
+    uint32_t key = fnvU32(fnvBytes(FnvOffset, site.getFunction()->getName()),
+                          instructionOrdinal(site));
+    for (uint32_t salt = 0; id == 0 || used.count(id); ++salt)
+      id = fnvU32(key, salt) & 0x7fffffffu;
+  }
+  used.insert(id);
+  return (int)id;
+}
+
+} // namespace vase
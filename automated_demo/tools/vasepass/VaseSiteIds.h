@@ -0,0 +1,59 @@
+// VaseSiteIds.h — site ids that survive rebuilds
+//
+// Sequential ids (1, 2, 3, … in module order) change whenever any branch is
+// added, removed or reordered anywhere before a site, which invalidates every
+// collected log and map. Stable ids are instead a hash of
+//   function name, debug location relative to the function's first line,
+//   the structure of the branch's basic block, and an ordinal among
+//   otherwise identical branches in the same function,
+// so a site keeps its id as long as its own function is unchanged. Ids are
+// positive 31-bit integers (loc:0 means "no site" to VaseSolver).
+//
+// functionHash summarizes a whole function the same way; the site manifest
+// records it so that tools/analyzer/diff_site_manifest.py can tell which
+// functions need re-profiling after a rebuild.
+
+#ifndef VASE_SITE_IDS_H
+#define VASE_SITE_IDS_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+
+#include <cstdint>
+
+namespace llvm {
+class Function;
+class Instruction;
+} // namespace llvm
+
+namespace vase {
+
+/// Structural hash of F: instruction opcodes, types, predicates, constant
+/// operands, callee/global names, local value numbering and relative debug
+/// lines. Independent of the function's position in the module.
+uint32_t functionHash(const llvm::Function &F);
+
+class SiteIds {
+public:
+  enum Scheme { Sequential, Stable };
+
+  explicit SiteIds(Scheme scheme) : scheme(scheme) {}
+
+  /// Call before numbering the branches of F.
+  void beginFunction(const llvm::Function &F);
+
+  /// Id of the next site (conditional branch, switch or select) of the
+  /// current function. Every site must be numbered, instrumented or not, in
+  /// a fixed order.
+  int next(const llvm::Instruction &site);
+
+private:
+  Scheme scheme;
+  int nextSequential = 1;
+  llvm::DenseSet<uint32_t> used;
+  llvm::DenseMap<uint32_t, uint32_t> ordinals; // per function
+};
+
+} // namespace vase
+
+#endif // VASE_SITE_IDS_H
@@ -0,0 +1,213 @@
+// VaseStaticValues.cpp — static value sets (see VaseStaticValues.h)
+
+#include "VaseStaticValues.h"
+
+#include "llvm/Analysis/LazyValueInfo.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/ConstantRange.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace llvm;
+
+namespace vase {
+
+static const unsigned MaxDepth = 6;
+
+// The value as the logger records it: bools zero-extended, everything else
+// sign-extended/truncated to 32 bits (see toI32 in VaseInstrumentPass.cpp).
+static int64_t loggedValue(const APInt &v) {
+  if (v.getBitWidth() == 1)
+    return v.getZExtValue();
+  return (int32_t)v.sextOrTrunc(32).getSExtValue();
+}
+
+StaticValueSets::StaticValueSets(Module &M, unsigned maxValues)
+    : M(M), maxValues(maxValues) {
+  indexGlobals();
+  indexSwitches();
+}
+
+void StaticValueSets::indexGlobals() {
+  for (GlobalVariable &GV : M.globals()) {
+    if (!GV.hasLocalLinkage() || !GV.hasInitializer() ||
+        !GV.getValueType()->isIntegerTy())
+      continue;
+    auto *init = dyn_cast<ConstantInt>(GV.getInitializer());
+    if (!init)
+      continue;
+
+    ValueSet values{loggedValue(init->getValue())};
+    bool onlyConstants = true;
+    for (User *U : GV.users()) {
+      if (auto *LI = dyn_cast<LoadInst>(U)) {
+        if (!LI->isVolatile())
+          continue;
+      } else if (auto *SI = dyn_cast<StoreInst>(U)) {
+        auto *C = dyn_cast<ConstantInt>(SI->getValueOperand());
+        if (C && SI->getPointerOperand() == &GV && !SI->isVolatile()) {
+          values.insert(loggedValue(C->getValue()));
+          continue;
+        }
+      }
+      onlyConstants = false; // address taken, cast, volatile, non-constant store
+      break;
+    }
+    if (onlyConstants && values.size() <= maxValues)
+      constantGlobals[&GV] = std::move(values);
+  }
+}
+
+void StaticValueSets::indexSwitches() {
+  for (Function &F : M) {
+    for (Instruction &I : instructions(F)) {
+      auto *SI = dyn_cast<SwitchInst>(&I);
+      if (!SI || SI->getNumCases() == 0 || SI->getNumCases() > maxValues)
+        continue;
+      if (isa<UnreachableInst>(SI->getDefaultDest()->getFirstNonPHIOrDbg()))
+        exhaustiveSwitches[SI->getCondition()].push_back(SI);
+    }
+  }
+}
+
+// Values reachable through constants, phis, selects, value-preserving casts,
+// compares and loads of constant-only globals.
+bool StaticValueSets::structural(Value *V, unsigned depth, ValueSet &out,
+                                 SmallPtrSetImpl<Value *> &visiting) {
+  if (depth > MaxDepth)
+    return false;
+
+  if (auto *C = dyn_cast<ConstantInt>(V)) {
+    out.insert(loggedValue(C->getValue()));
+    return out.size() <= maxValues;
+  }
+
+  if (isa<CmpInst>(V)) {
+    out.insert(0);
+    out.insert(1);
+    return out.size() <= maxValues;
+  }
+
+  if (auto *CI = dyn_cast<CastInst>(V)) {
+    Value *src = CI->getOperand(0);
+    if (!src->getType()->isIntegerTy())
+      return false;
+    if (isa<SExtInst>(CI) && src->getType()->isIntegerTy(1)) {
+      out.insert(0);
+      out.insert(-1);
+      return out.size() <= maxValues;
+    }
+    if (isa<SExtInst>(CI))
+      return structural(src, depth + 1, out, visiting);
+    if (isa<ZExtInst>(CI)) {
+      // Only value-preserving when the source values are non-negative.
+      ValueSet inner;
+      if (!structural(src, depth + 1, inner, visiting) ||
+          (!inner.empty() && *inner.begin() < 0))
+        return false;
+      out.insert(inner.begin(), inner.end());
+      return out.size() <= maxValues;
+    }
+    return false;
+  }
+
+  if (auto *Sel = dyn_cast<SelectInst>(V))
+    return structural(Sel->getTrueValue(), depth + 1, out, visiting) &&
+           structural(Sel->getFalseValue(), depth + 1, out, visiting);
+
+  if (auto *PN = dyn_cast<PHINode>(V)) {
+    // A cycle through phis/selects only carries values that enter it from
+    // elsewhere.
+    if (!visiting.insert(PN).second)
+      return true;
+    for (Value *in : PN->incoming_values())
+      if (!structural(in, depth + 1, out, visiting))
+        return false;
+    return true;
+  }
+
+  if (auto *LI = dyn_cast<LoadInst>(V)) {
+    auto *GV = dyn_cast<GlobalVariable>(LI->getPointerOperand());
+    if (!GV || LI->isVolatile())
+      return false;
+    auto it = constantGlobals.find(GV);
+    if (it == constantGlobals.end())
+      return false;
+    out.insert(it->second.begin(), it->second.end());
+    return out.size() <= maxValues;
+  }
+
+  return false;
+}
+
+bool StaticValueSets::constantRange(Value *V, Instruction *at,
+                                    LazyValueInfo &LVI, ValueSet &out) {
+  auto *T = dyn_cast<IntegerType>(V->getType());
+  if (!T || T->getBitWidth() > 64)
+    return false;
+#if LLVM_VERSION_MAJOR >= 12
+  ConstantRange CR = LVI.getConstantRange(V, at);
+#else
+  ConstantRange CR = LVI.getConstantRange(V, at->getParent(), at);
+#endif
+  if (CR.isFullSet() || CR.isEmptySet())
+    return false;
+  APInt size = CR.getUpper() - CR.getLower(); // modular, so wrapped ranges work
+  if (size.ugt(maxValues))
+    return false;
+  APInt v = CR.getLower();
+  for (uint64_t n = size.getZExtValue(); n; --n, ++v)
+    out.insert(loggedValue(v));
+  return true;
+}
+
+bool StaticValueSets::valuesAt(Value *V, Instruction *at, LazyValueInfo *LVI,
+                               DominatorTree *DT, std::vector<int64_t> &out) {
+  // Every source that succeeds is a sound over-approximation; intersect them.
+  std::vector<ValueSet> found;
+
+  ValueSet s;
+  SmallPtrSet<Value *, 8> visiting;
+  if (structural(V, 0, s, visiting) && !s.empty())
+    found.push_back(std::move(s));
+
+  // Once an exhaustive switch on V has run, V is one of its cases.
+  auto it = exhaustiveSwitches.find(V);
+  if (DT && it != exhaustiveSwitches.end()) {
+    for (const SwitchInst *SI : it->second) {
+      if (SI->getFunction() != at->getFunction() || !DT->dominates(SI, at))
+        continue;
+      ValueSet cases;
+      for (auto &Case : SI->cases())
+        cases.insert(loggedValue(Case.getCaseValue()->getValue()));
+      found.push_back(std::move(cases));
+    }
+  }
+
+  ValueSet r;
+  if (LVI && constantRange(V, at, *LVI, r))
+    found.push_back(std::move(r));
+
+  if (found.empty())
+    return false;
+  ValueSet values = std::move(found.front());
+  for (size_t i = 1; i < found.size(); ++i) {
+    ValueSet both;
+    std::set_intersection(values.begin(), values.end(), found[i].begin(),
+                          found[i].end(), std::inserter(both, both.end()));
+    values = std::move(both);
+  }
+  if (values.empty() || values.size() > maxValues)
+    return false;
+  out.assign(values.begin(), values.end());
+  return true;
+}
+
+} // namespace vase
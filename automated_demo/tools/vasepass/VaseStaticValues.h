@@ -0,0 +1,63 @@
+// VaseStaticValues.h — static value sets for VASE branch operands
+//
+// Many limited-valued operands never need to be profiled: a `bool` flag is
+// 0 or 1, a phi/select of enum constants takes only those constants, a file
+// static that is only ever assigned a few constants holds one of them, and
+// past a switch with an unreachable default the switched value is one of the
+// case values. LazyValueInfo adds whatever constant range it can prove at the
+// branch. When the set has at most `maxValues` elements it is exact enough to
+// go straight into limitedValuedMap.json.
+
+#ifndef VASE_STATIC_VALUES_H
+#define VASE_STATIC_VALUES_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace llvm {
+class DominatorTree;
+class GlobalVariable;
+class Instruction;
+class LazyValueInfo;
+class Module;
+class SwitchInst;
+class Value;
+} // namespace llvm
+
+namespace vase {
+
+class StaticValueSets {
+public:
+  StaticValueSets(llvm::Module &M, unsigned maxValues);
+
+  /// Values V can take when `at` executes, in ascending order. False if the
+  /// set is unknown or larger than maxValues. `LVI` and `DT` may be null.
+  bool valuesAt(llvm::Value *V, llvm::Instruction *at, llvm::LazyValueInfo *LVI,
+                llvm::DominatorTree *DT, std::vector<int64_t> &out);
+
+private:
+  using ValueSet = std::set<int64_t>;
+
+  void indexGlobals();
+  void indexSwitches();
+  bool structural(llvm::Value *V, unsigned depth, ValueSet &out,
+                  llvm::SmallPtrSetImpl<llvm::Value *> &visiting);
+  bool constantRange(llvm::Value *V, llvm::Instruction *at,
+                     llvm::LazyValueInfo &LVI, ValueSet &out);
+
+  llvm::Module &M;
+  unsigned maxValues;
+
+  /// Internal integer globals that are only ever stored constants.
+  llvm::DenseMap<const llvm::GlobalVariable *, ValueSet> constantGlobals;
+  /// Switches with an unreachable default, by condition.
+  llvm::DenseMap<const llvm::Value *, std::vector<const llvm::SwitchInst *>> exhaustiveSwitches;
+};
+
+} // namespace vase
+
+#endif // VASE_STATIC_VALUES_H
@@ -0,0 +1,257 @@
+// VaseTaint.cpp — input-dependence analysis (see VaseTaint.h)
+
+#include "VaseTaint.h"
+
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+
+namespace vase {
+
+// Functions whose return value and pointer arguments carry program input.
+// These are the libc entry points KLEE's POSIX runtime backs with symbolic
+// data (--sym-args, --sym-files, --sym-stdin).
+static const char *const DefaultSources[] = {
+  "read", "pread", "pread64", "readv",
+  "fread", "fread_unlocked", "fgets", "fgets_unlocked",
+  "fgetc", "getc", "getc_unlocked", "getchar", "getchar_unlocked",
+  "getline", "getdelim", "__getdelim", "fscanf", "scanf",
+  "getopt", "getopt_long", "getopt_long_only",
+  "stat", "lstat", "fstat", "fstatat", "stat64", "lstat64", "fstat64",
+  "__xstat", "__lxstat", "__fxstat", "__fxstatat",
+  "__xstat64", "__lxstat64", "__fxstat64",
+  "readdir", "readdir64", "readlink",
+};
+
+// Globals the getopt family writes from argv.
+static const char *const SourceGlobals[] = { "optarg", "optind", "optopt" };
+
+InputTaint::InputTaint(Module &M, const std::vector<std::string> &extraSources)
+    : M(M) {
+  for (const char *name : DefaultSources)
+    sources.insert(name);
+  for (const std::string &name : extraSources)
+    sources.insert(name);
+}
+
+const Value *InputTaint::memoryObject(const Value *ptr) const {
+#if LLVM_VERSION_MAJOR >= 12
+  const Value *obj = getUnderlyingObject(ptr);
+#else
+  const Value *obj = GetUnderlyingObject(ptr, M.getDataLayout());
+#endif
+  if (isa<AllocaInst>(obj) || isa<GlobalVariable>(obj) || isa<Argument>(obj) ||
+      isa<CallBase>(obj))
+    return obj;
+  return nullptr;
+}
+
+std::vector<const Function *>
+InputTaint::indirectTargets(const CallBase &CB) const {
+  std::vector<const Function *> targets;
+  for (const Function *F : addressTaken)
+    if (F->arg_size() == CB.arg_size() ||
+        (F->isVarArg() && F->arg_size() < CB.arg_size()))
+      targets.push_back(F);
+  return targets;
+}
+
+void InputTaint::indexModule() {
+  for (Function &F : M)
+    if (!F.isDeclaration() && F.hasAddressTaken())
+      addressTaken.push_back(&F);
+
+  for (Function &F : M) {
+    for (Instruction &I : instructions(F)) {
+      if (auto *LI = dyn_cast<LoadInst>(&I)) {
+        if (const Value *obj = memoryObject(LI->getPointerOperand()))
+          loadsByObject[obj].push_back(LI);
+        else
+          unnamedLoadsByType[LI->getType()].push_back(LI);
+      } else if (auto *MT = dyn_cast<MemTransferInst>(&I)) {
+        if (const Value *obj = memoryObject(MT->getRawSource()))
+          memoryUses[obj].push_back({MemoryUse::CopyDest, MT->getRawDest()});
+      } else if (auto *CB = dyn_cast<CallBase>(&I)) {
+        const Function *callee = CB->getCalledFunction();
+        if (callee)
+          callers[callee].push_back(CB);
+        else if (CB->isIndirectCall()) {
+          // Its results and out-pointers come back as from a direct call
+          auto &targets = indirectCallees[CB] = indirectTargets(*CB);
+          for (const Function *T : targets)
+            callers[T].push_back(CB);
+        }
+        if (isa<DbgInfoIntrinsic>(CB))
+          continue;
+        bool external = !callee || callee->isDeclaration();
+        for (unsigned i = 0; i < CB->arg_size(); ++i) {
+          const Value *arg = CB->getArgOperand(i);
+          if (!arg->getType()->isPointerTy())
+            continue;
+          const Value *obj = memoryObject(arg);
+          if (!obj)
+            continue;
+          if (external)
+            memoryUses[obj].push_back({MemoryUse::ExternalCall, CB});
+          else if (i < callee->arg_size())
+            memoryUses[obj].push_back({MemoryUse::Param, callee->arg_begin() + i});
+          if (!callee)
+            for (const Function *T : indirectCallees.lookup(CB))
+              if (i < T->arg_size())
+                memoryUses[obj].push_back({MemoryUse::Param, T->arg_begin() + i});
+        }
+      }
+    }
+  }
+}
+
+void InputTaint::seedSources() {
+  if (Function *main = M.getFunction("main")) {
+    for (Argument &A : main->args())
+      taintValue(&A); // argc, argv (and envp, which KLEE models too)
+  }
+
+  for (const char *name : SourceGlobals) {
+    if (GlobalVariable *GV = M.getGlobalVariable(name))
+      taintMemory(GV);
+  }
+
+  for (Function &F : M) {
+    if (!sources.count(F.getName()))
+      continue;
+    auto it = callers.find(&F);
+    if (it == callers.end())
+      continue;
+    for (const CallBase *CB : it->second)
+      taintCallOutputs(*CB);
+  }
+}
+
+void InputTaint::taintValue(const Value *V) {
+  if (V->getType()->isVoidTy() || isa<Constant>(V))
+    return;
+  if (values.insert(V).second)
+    worklist.push_back(V);
+}
+
+void InputTaint::taintMemory(const Value *ptr, bool written) {
+  const Value *obj = memoryObject(ptr);
+  if (!obj) {
+    // Unnamed memory: fall back to "any unnamed load of this type".
+    Type *T = ptr->getType()->getPointerElementType();
+    if (!objectTypes.insert(T).second)
+      return;
+    auto it = unnamedLoadsByType.find(T);
+    if (it != unnamedLoadsByType.end())
+      for (const Value *LI : it->second)
+        taintValue(LI);
+    return;
+  }
+
+  // An out-parameter written in the callee taints the caller's object.
+  if (auto *A = dyn_cast<Argument>(obj)) {
+    if (written && writtenArgs.insert(A).second) {
+      auto cit = callers.find(A->getParent());
+      if (cit != callers.end())
+        for (const CallBase *CB : cit->second)
+          if (A->getArgNo() < CB->arg_size())
+            taintMemory(CB->getArgOperand(A->getArgNo()));
+    }
+  }
+
+  if (!objects.insert(obj).second)
+    return;
+
+  auto it = loadsByObject.find(obj);
+  if (it != loadsByObject.end())
+    for (const Value *LI : it->second)
+      taintValue(LI);
+
+  auto uit = memoryUses.find(obj);
+  if (uit != memoryUses.end()) {
+    for (const MemoryUse &use : uit->second) {
+      if (use.kind == MemoryUse::ExternalCall)
+        taintCallOutputs(*cast<CallBase>(use.target));
+      else
+        taintMemory(use.target, use.kind == MemoryUse::CopyDest);
+    }
+  }
+}
+
+void InputTaint::taintCallOutputs(const CallBase &CB) {
+  taintValue(&CB);
+  for (const Value *arg : CB.args())
+    if (arg->getType()->isPointerTy() && !isa<Constant>(arg))
+      taintMemory(arg);
+}
+
+void InputTaint::propagate(const Value *V) {
+  for (const User *U : V->users()) {
+    const auto *I = dyn_cast<Instruction>(U);
+    if (!I)
+      continue;
+
+    if (const auto *SI = dyn_cast<StoreInst>(I)) {
+      if (SI->getValueOperand() == V)
+        taintMemory(SI->getPointerOperand());
+      continue;
+    }
+
+    if (isa<DbgInfoIntrinsic>(I))
+      continue;
+
+    if (const auto *CB = dyn_cast<CallBase>(I)) {
+      const Function *callee = CB->getCalledFunction();
+      if (callee && !callee->isDeclaration()) {
+        for (unsigned i = 0; i < CB->arg_size() && i < callee->arg_size(); ++i)
+          if (CB->getArgOperand(i) == V)
+            taintValue(callee->arg_begin() + i);
+        continue;
+      }
+      // Indirect callee: the parameters of every function it may reach
+      if (!callee)
+        for (const Function *T : indirectCallees.lookup(CB))
+          for (unsigned i = 0; i < CB->arg_size() && i < T->arg_size(); ++i)
+            if (CB->getArgOperand(i) == V)
+              taintValue(T->arg_begin() + i);
+      // External or indirect callee: assume the input reaches the result and
+      // everything it can write through its pointer arguments.
+      taintCallOutputs(*CB);
+      continue;
+    }
+
+    if (const auto *RI = dyn_cast<ReturnInst>(I)) {
+      auto it = callers.find(RI->getFunction());
+      if (it != callers.end())
+        for (const CallBase *CB : it->second)
+          taintValue(CB);
+      continue;
+    }
+
+    if (I->isTerminator())
+      continue;
+
+    // Loads through a tainted pointer, arithmetic, casts, compares, phis,
+    // selects, GEPs: the result depends on the operand.
+    taintValue(I);
+  }
+}
+
+void InputTaint::run() {
+  indexModule();
+  seedSources();
+  while (!worklist.empty()) {
+    const Value *V = worklist.back();
+    worklist.pop_back();
+    propagate(V);
+  }
+}
+
+} // namespace vase
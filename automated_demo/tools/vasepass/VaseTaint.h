@@ -0,0 +1,94 @@
+// VaseTaint.h — module-level input-dependence (taint) analysis for the VASE pass
+//
+// A value is input-dependent when it may be derived from main's argc/argv or
+// from data returned by an input function (read, fgets, getopt_long, stat, …).
+// KLEE models exactly these inputs symbolically, so only branch operands that
+// are input-dependent can ever show up in a solver query VaseSolver rewrites.
+//
+// The analysis is a flow-insensitive forward propagation over def-use chains,
+// memory (store -> load through the same underlying object) and calls
+// (arguments -> parameters, returns -> call results, out-pointers -> caller
+// objects). An indirect call may reach every address-taken function of
+// matching arity. It over-approximates; unknown externals propagate
+// conservatively.
+
+#ifndef VASE_TAINT_H
+#define VASE_TAINT_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSet.h"
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+class CallBase;
+class Function;
+class Module;
+class Type;
+class Value;
+} // namespace llvm
+
+namespace vase {
+
+class InputTaint {
+public:
+  /// `extraSources` names additional functions whose results and pointer
+  /// arguments carry input data.
+  InputTaint(llvm::Module &M, const std::vector<std::string> &extraSources);
+
+  /// Run to a fixpoint. Must be called before isTainted.
+  void run();
+
+  bool isTainted(const llvm::Value *V) const { return values.count(V) != 0; }
+
+  size_t numTaintedValues() const { return values.size(); }
+
+private:
+  void indexModule();
+  void seedSources();
+  void propagate(const llvm::Value *V);
+
+  void taintValue(const llvm::Value *V);
+  /// `written` is false when the memory is merely reachable through a
+  /// parameter; only writes flow back out of a callee's pointer arguments.
+  void taintMemory(const llvm::Value *ptr, bool written = true);
+  void taintCallOutputs(const llvm::CallBase &CB);
+  /// Defined functions an indirect call may reach: the address-taken ones
+  /// whose parameters it can fill.
+  std::vector<const llvm::Function *> indirectTargets(const llvm::CallBase &CB) const;
+
+  /// Identified allocation behind `ptr`, or null if it cannot be named
+  /// (loaded pointers, pointer arithmetic on integers, …).
+  const llvm::Value *memoryObject(const llvm::Value *ptr) const;
+
+  llvm::Module &M;
+  llvm::StringSet<> sources;
+
+  llvm::DenseSet<const llvm::Value *> values;
+  llvm::DenseSet<const llvm::Value *> objects;
+  llvm::DenseSet<const llvm::Value *> writtenArgs;
+  llvm::SmallPtrSet<llvm::Type *, 16> objectTypes; // fallback for unnamed memory
+  std::vector<const llvm::Value *> worklist;
+
+  // What else becomes tainted once an object's memory is: parameters it is
+  // passed to, memcpy destinations it is copied to, external calls that read
+  // it (strtol, strcmp, …).
+  struct MemoryUse {
+    enum Kind { Param, CopyDest, ExternalCall } kind;
+    const llvm::Value *target;
+  };
+
+  llvm::DenseMap<const llvm::Value *, std::vector<const llvm::Value *>> loadsByObject;
+  llvm::DenseMap<const llvm::Value *, std::vector<MemoryUse>> memoryUses;
+  llvm::DenseMap<llvm::Type *, std::vector<const llvm::Value *>> unnamedLoadsByType;
+  llvm::DenseMap<const llvm::Function *, std::vector<const llvm::CallBase *>> callers;
+  llvm::DenseMap<const llvm::CallBase *, std::vector<const llvm::Function *>> indirectCallees;
+  std::vector<const llvm::Function *> addressTaken;
+};
+
+} // namespace vase
+
+#endif // VASE_TAINT_H
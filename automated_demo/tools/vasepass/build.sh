@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+# Build the VASE instrumentation pass as an `opt -load` plugin.
+#
+#   LLVM_CONFIG=/usr/lib/llvm-10/bin/llvm-config ./build.sh
+#
+# Output: libVaseInstrumentPass.so next to this script (the default PASS_SO of
+# evp_pipeline.py and the collection scripts), or $OUT. Extra compiler flags
+# (e.g. -fsanitize=address, see test_vasepass.py) go in $VASE_CXXFLAGS.
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+LLVM_CONFIG="${LLVM_CONFIG:-/usr/lib/llvm-10/bin/llvm-config}"
+CXX="${CXX:-$("$LLVM_CONFIG" --bindir)/clang++}"
+OUT="${OUT:-$SCRIPT_DIR/libVaseInstrumentPass.so}"
+
+"$CXX" -shared -fPIC -O2 -g \
+  $("$LLVM_CONFIG" --cxxflags) ${VASE_CXXFLAGS:-} \
+  "$SCRIPT_DIR"/*.cpp \
+  -o "$OUT"
+
+echo "Built $OUT ($("$LLVM_CONFIG" --version))"
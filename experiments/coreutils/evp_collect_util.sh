@@ -19,8 +19,9 @@ Optional:
   --only-collect             Run collection only (skip map generation)
   --only-map                 Run map generation only (uses existing log)
   --opt PATH                 LLVM opt (default: /usr/lib/llvm-10/bin/opt)
-  --pass-so PATH             VASE pass .so (default: /home/roxana/VASE-klee/vasepass/libVaseInstrumentPass.so)
-  --logger-c PATH            logger.c (not compiled here; kept for consistency)
+  --pass-so PATH             VASE pass .so (default: in-tree automated_demo/tools/vasepass,
+                             built with its build.sh)
+  --logger-c PATH            logger.c (default: in-tree automated_demo/tools/logger/logger.c)
   -h, --help                 Show this help
 
 Notes:
@@ -42,9 +43,12 @@ TESTS_FILE=""
 ONLY_COLLECT=0
 ONLY_MAP=0
 
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+TOOLS_DIR="$(cd "$SCRIPT_DIR/../../automated_demo/tools" && pwd)"
+
 OPT_BIN="${OPT:-/usr/lib/llvm-10/bin/opt}"
-PASS_SO="${PASS_SO:-/home/roxana/VASE-klee/vasepass/libVaseInstrumentPass.so}"
-LOGGER_C="${LOG_C:-/home/roxana/VASE-klee/logger.c}"
+PASS_SO="${PASS_SO:-$TOOLS_DIR/vasepass/libVaseInstrumentPass.so}"
+LOGGER_C="${LOG_C:-$TOOLS_DIR/logger/logger.c}"
 
 while (( "$#" )); do
   case "$1" in
@@ -67,8 +71,6 @@ done
 [[ -z "${UTIL}" ]] && { echo "Error: --util is required"; usage; exit 1; }
 
 # === Directories, paths, tools ===============================================
-SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
-
 # Coreutils dir: explicit > sibling > parent sibling
 if [[ -n "${COREUTILS_DIR_ARG}" ]]; then
   COREUTILS_DIR="${COREUTILS_DIR_ARG}"
@@ -98,6 +100,7 @@ OUT_DIR="$(cd "$OUT_DIR" && pwd)"
 LOG_FILE="$UTIL_DIR/collection.log"
 VASE_LOG="$UTIL_DIR/vase_value_log.txt"
 MAP_JSON="$UTIL_DIR/limitedValuedMap.json"
+STATIC_MAP="$UTIL_DIR/staticValueMap.json"
 
 # === Logging helpers ==========================================================
 log() {
@@ -128,7 +131,7 @@ fi
 # === Instrumentation (Step 1A) ===============================================
 if [[ "$ONLY_MAP" -eq 0 ]]; then
   log "Applying EVP instrumentation to $BASE_BC → $INSTR_BC ..."
-  "$OPT_BIN" -load "$PASS_SO" -vase-instrument "$BASE_BC" -o "$INSTR_BC"
+  "$OPT_BIN" -load "$PASS_SO" -vase-instrument -vase-static-map="$STATIC_MAP" "$BASE_BC" -o "$INSTR_BC"
   log "Instrumentation complete: $INSTR_BC"
 
 # Build runtime logger as a shared object and an instrumented executable
@@ -287,11 +290,14 @@ if [[ "$ONLY_COLLECT" -eq 0 ]]; then
   log "Generating limited value map → $MAP_JSON (max=$MAX_VALUES, min=$MIN_OCCURRENCE)"
 
   # Your Python has CLI flags; keep that interface.
+  STATIC_ARGS=()
+  [[ -f "$STATIC_MAP" ]] && STATIC_ARGS=(--static-map "$STATIC_MAP")
   python3 generate_limited_map.py \
     --log "$VASE_LOG" \
     --out "$MAP_JSON" \
     --max-values "$MAX_VALUES" \
-    --min-occurrence "$MIN_OCCURRENCE"
+    --min-occurrence "$MIN_OCCURRENCE" \
+    ${STATIC_ARGS[@]+"${STATIC_ARGS[@]}"}
 
   log "Map generation completed"
   echo "=== Map Generation Completed $(date) ===" >> "$LOG_FILE"
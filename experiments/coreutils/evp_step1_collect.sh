@@ -10,8 +10,9 @@ if [[ -z "$UTILITY" ]]; then
 CLANG="${CLANG:-/usr/lib/llvm-10/bin/clang}"
 OPT="${OPT:-/usr/lib/llvm-10/bin/opt}"
 LLVMLINK="${LLVMLINK:-/usr/lib/llvm-10/bin/llvm-link}"
-PASS_SO="${PASS_SO:-/home/roxana/VASE-klee/vasepass/libVaseInstrumentPass.so}"
-LOGGER_C="${LOGGER_C:-/home/roxana/VASE-klee/logger.c}"
+TOOLS_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/../../automated_demo/tools" && pwd)"
+PASS_SO="${PASS_SO:-$TOOLS_DIR/vasepass/libVaseInstrumentPass.so}"
+LOGGER_C="${LOGGER_C:-$TOOLS_DIR/logger/logger.c}"
 ROOT="${ROOT:-/home/roxana/Downloads/klee-mm-benchmarks/coreutils}"
 CU="${CU:-$ROOT/coreutils-8.31}"
 BUILD_DIR="$CU/obj-llvm"
@@ -3,7 +3,7 @@ import argparse
 import json
 import os
 import re
-from collections import defaultdict
+from collections import Counter, defaultdict
 
 def parse_args():
     p = argparse.ArgumentParser(description="Build VASE limited-valued map from vase_value_log.txt")
@@ -17,6 +17,16 @@ def parse_args():
                    help="Minimum times a var must be observed at a site (across runs) (default: 2)")
     p.add_argument("--no-branchless", action="store_true",
                    help="Do NOT emit base keys loc:N aggregated across branches (by default branchless keys are emitted)")
+    p.add_argument("--no-context", action="store_true",
+                   help="Do NOT emit calling-context keys loc:N[:branch:B]:ctx:H (logged when VASE_CTX_DEPTH > 0)")
+    p.add_argument("--no-input-offsets", action="store_true",
+                   help="Do NOT emit loc:N:arr:NAME:OFF:W keys from input-offset records (-vase-input-offsets)")
+    p.add_argument("--no-dedup", action="store_true",
+                   help="Spell out every loc:N union even where it is derivable from the loc:N:branch:B lists (for older VaseSolver builds)")
+    p.add_argument("--static-map",
+                   help="Static value sets from the pass (-vase-static-map); fills in vars the log has no limited entry for")
+    p.add_argument("--carry-map",
+                   help="Entries carried over from an earlier build (diff_site_manifest.py --out-map); fills in vars the log does not cover")
     return p.parse_args()
 
 def main():
@@ -26,17 +36,35 @@ def main():
     MAX_LIMITED_VALUES = args.max_values
     MIN_OCCURRENCE = args.min_occurrence
     keep_branchless = not args.no_branchless
+    keep_context = not args.no_context
+    keep_inputs = not args.no_input_offsets
 
     if not os.path.exists(log_file):
         print(f"❌ Log file not found: {log_file}")
         return
 
-    # value_map[loc][branch][var] = set(values)
-    value_map = defaultdict(lambda: defaultdict(lambda: defaultdict(set)))
+    # value_map[loc][branch][var] = Counter(value -> times observed)
+    value_map = defaultdict(lambda: defaultdict(lambda: defaultdict(Counter)))
     # occ_count[loc][branch][var] = count
     occ_count = defaultdict(lambda: defaultdict(lambda: defaultdict(int)))
+    # Same, split by calling context: ctx_values[loc][ctx][branch][var]
+    ctx_values = defaultdict(lambda: defaultdict(lambda: defaultdict(lambda: defaultdict(Counter))))
+    ctx_occ = defaultdict(lambda: defaultdict(lambda: defaultdict(lambda: defaultdict(int))))
+    # input_values[(loc, array, offset, width)][var] = Counter(values)
+    input_values = defaultdict(lambda: defaultdict(Counter))
+    input_occ = defaultdict(lambda: defaultdict(int))
 
-    line_re = re.compile(r'^loc:(-?\d+):branch:(-?\d+)$')
+    # loc:N:branch:B  per-iteration branch record
+    # loc:N            operand logged once per loop entry (no branch known)
+    # loc:N:iv         induction-variable summary "var:start:step:count"
+    line_re = re.compile(r'^loc:(-?\d+)(?::branch:(-?\d+)|:(iv))?(?::ctx:([0-9a-fA-F]+))?$')
+    # loc:N:input:ARRAY:OFF:W  the value was loaded from bytes OFF..OFF+W-1 of
+    #                          KLEE array ARRAY
+    input_re = re.compile(r'^loc:(-?\d+):input:([^:]+):(\d+):(\d+)$')
+    # "<record>\t#N": the record repeated N times (logger VASE_AGGREGATE=1)
+    repeat_re = re.compile(r'^#[1-9][0-9]{0,17}$')
+    # Branchless records only feed the loc:N union, under this pseudo-branch.
+    NO_BRANCH = "*"
 
     total_lines = 0
     good_lines = 0
@@ -55,23 +83,39 @@ def main():
                 continue
 
             loc_part, var_part = line.split("\t", 1)
+            repeat = 1
+            head, sep, tail = var_part.rpartition("\t")
+            if sep and repeat_re.match(tail):
+                var_part, repeat = head, int(tail[1:])
             m = line_re.match(loc_part)
             if not m:
+                im = input_re.match(loc_part)
+                var_name, _, var_value = var_part.partition(":")
+                if im and var_name.strip() and var_value.strip():
+                    input_values[im.groups()][var_name.strip()][var_value.strip()] += repeat
+                    input_occ[im.groups()][var_name.strip()] += repeat
+                    good_lines += 1
+                    continue
                 skipped_malformed += 1
                 continue
 
             loc = m.group(1)
             branch = m.group(2)
-            try:
-                b = int(branch)
-            except Exception:
-                skipped_malformed += 1
-                continue
+            is_iv = m.group(3) is not None
+            ctx = m.group(4)
+            if branch is None:
+                branch = NO_BRANCH
+            else:
+                try:
+                    b = int(branch)
+                except Exception:
+                    skipped_malformed += 1
+                    continue
 
-            # negative branches (e.g., function entry) are not decision points
-            if b < 0:
-                skipped_neg_branch += 1
-                continue
+                # negative branches (e.g., function entry) are not decision points
+                if b < 0:
+                    skipped_neg_branch += 1
+                    continue
 
             if ":" not in var_part:
                 skipped_malformed += 1
@@ -84,8 +128,34 @@ def main():
                 skipped_malformed += 1
                 continue
 
-            value_map[loc][branch][var_name].add(var_value)
-            occ_count[loc][branch][var_name] += 1
+            if is_iv:
+                # The compare saw start, start+step, ... count times; past
+                # MAX_LIMITED_VALUES + 1 distinct values the var is unlimited
+                # anyway, so don't expand further.
+                try:
+                    start, step, count = (int(x) for x in var_value.split(":"))
+                except Exception:
+                    skipped_malformed += 1
+                    continue
+                if count <= 0:
+                    continue
+                n = min(count, MAX_LIMITED_VALUES + 1) if step else 1
+                values = [str(start + i * step) for i in range(n)]
+            else:
+                values = [var_value]
+                count = 1
+            # A constant IV was compared `count` times, a stepping one once per value.
+            seen = (count if len(values) == 1 else 1) * repeat
+            count *= repeat
+
+            for v in values:
+                value_map[loc][branch][var_name][v] += seen
+            occ_count[loc][branch][var_name] += count
+            if ctx is not None:
+                ctx = ctx.lower()
+                for v in values:
+                    ctx_values[loc][ctx][branch][var_name][v] += seen
+                ctx_occ[loc][ctx][branch][var_name] += count
             good_lines += 1
 
     # Build output JSON: include branch-qualified keys and base (loc:N) keys by default
@@ -99,45 +169,136 @@ def main():
             vals.sort()
         return vals
 
+    def ranked_values(counts):
+        # Most observed first, so VaseSolver tries the likeliest value first;
+        # ties in numeric order.
+        vals = sorted_values(counts)
+        vals.sort(key=lambda v: -counts[v])
+        return vals
+
+    def limited(vars, occ):
+        limited_vars = {}
+        for var, counts in vars.items():
+            if occ[var] < MIN_OCCURRENCE:
+                continue
+            if len(counts) <= MAX_LIMITED_VALUES:
+                limited_vars[var] = [{"type": 0, "value": v, "weight": counts[v]}
+                                     for v in ranked_values(counts)]
+        return limited_vars
+
+    def ranking(limited_vars):
+        return {var: [e["value"] for e in values] for var, values in limited_vars.items()}
+
+    def union(branches, occ):
+        # Base (branchless): union values across branches, sum occurrences
+        union_vals = defaultdict(Counter)
+        union_occ = defaultdict(int)
+        for branch, vars in branches.items():
+            for var, values in vars.items():
+                union_vals[var].update(values)
+                union_occ[var] += occ[branch][var]
+        return union_vals, union_occ
+
     # 1) Branch-qualified
     for loc, branches in value_map.items():
         for branch, vars in branches.items():
-            limited_vars = {}
-            for var, values in vars.items():
-                if occ_count[loc][branch][var] < MIN_OCCURRENCE:
-                    continue
-                if len(values) <= MAX_LIMITED_VALUES:
-                    limited_vars[var] = [{"type": 0, "value": v} for v in sorted_values(values)]
+            if branch == NO_BRANCH:
+                continue
+            limited_vars = limited(vars, occ_count[loc][branch])
             if limited_vars:
                 output[f"loc:{loc}:branch:{branch}"] = limited_vars
 
-    # 2) Base (branchless): union values across branches, sum occurrences
+    # 2) Base (branchless)
     if keep_branchless:
         for loc, branches in value_map.items():
-            union_vals = defaultdict(set)
-            union_occ = defaultdict(int)
-            for branch, vars in branches.items():
-                for var, values in vars.items():
-                    union_vals[var].update(values)
-                    union_occ[var] += occ_count[loc][branch][var]
-            limited_vars = {}
-            for var, values in union_vals.items():
-                if union_occ[var] < MIN_OCCURRENCE:
-                    continue
-                if len(values) <= MAX_LIMITED_VALUES:
-                    limited_vars[var] = [{"type": 0, "value": v} for v in sorted_values(values)]
+            limited_vars = limited(*union(branches, occ_count[loc]))
             if limited_vars:
                 output[f"loc:{loc}"] = limited_vars
 
+    # 3) Context-qualified: only where splitting by calling context yields a
+    #    different (narrower, newly limited or differently ranked) entry than
+    #    the merged key, which VaseSolver falls back to anyway.
+    ctx_entries = 0
+    if keep_context:
+        for loc, contexts in ctx_values.items():
+            for ctx, branches in contexts.items():
+                keys = [(f"loc:{loc}:branch:{b}", f"loc:{loc}:branch:{b}:ctx:{ctx}",
+                         limited(vars, ctx_occ[loc][ctx][b]))
+                        for b, vars in branches.items() if b != NO_BRANCH]
+                if keep_branchless:
+                    keys.append((f"loc:{loc}", f"loc:{loc}:ctx:{ctx}",
+                                 limited(*union(branches, ctx_occ[loc][ctx]))))
+                for merged_key, ctx_key, limited_vars in keys:
+                    if limited_vars and (merged_key not in output or
+                                         ranking(limited_vars) != ranking(output[merged_key])):
+                        output[ctx_key] = limited_vars
+                        ctx_entries += 1
+
+    # 3b) Input bytes: keyed by site, KLEE array and offset, so VaseSolver
+    #     constrains them directly, and only in queries of the site that read them.
+    input_entries = 0
+    if keep_inputs:
+        for (loc, array, offset, width), vars in sorted(
+                input_values.items(), key=lambda e: (int(e[0][0]), e[0][1], int(e[0][2]), int(e[0][3]))):
+            limited_vars = limited(vars, input_occ[(loc, array, offset, width)])
+            if limited_vars:
+                output[f"loc:{loc}:arr:{array}:{offset}:{width}"] = limited_vars
+                input_entries += 1
+
+    def fill_in(path, max_values=None):
+        # Add vars the log produced no entry for; returns how many were added.
+        with open(path, "r", encoding="utf-8") as f:
+            extra = json.load(f)
+        added = 0
+        for key, vars in extra.items():
+            for var, values in vars.items():
+                if var in output.get(key, {}):
+                    continue
+                if max_values is not None and len(values) > max_values:
+                    continue
+                output.setdefault(key, {})[var] = values
+                added += 1
+        return added
+
+    # 4) Static value sets: proven by the pass, so no occurrence threshold. A
+    #    dynamic entry for the same var wins (it is what the tests exercised).
+    static_vars = fill_in(args.static_map, MAX_LIMITED_VALUES) if args.static_map else 0
+
+    # 5) Entries of functions unchanged since the last profiled build.
+    carried_vars = fill_in(args.carry_map) if args.carry_map else 0
+
+    # 6) Deduplicate: a loc:N var whose list is exactly what VaseSolver derives
+    #    from the loc:N:branch:B lists (values merged, weights summed, ranked
+    #    again) is written as [] and derived at load time.
+    derived_vars = 0
+    if not args.no_dedup:
+        branch_keys = defaultdict(list)
+        for key in output:
+            m = re.match(r'^loc:(-?\d+):branch:-?\d+$', key)
+            if m:
+                branch_keys[m.group(1)].append(key)
+        for loc, keys in branch_keys.items():
+            for var, values in output.get(f"loc:{loc}", {}).items():
+                entries = [e for key in keys for e in output[key].get(var, [])]
+                if not all(isinstance(e, dict) and isinstance(e.get("value"), str) and
+                           type(e.get("weight")) is int for e in entries):
+                    continue
+                counts = Counter()
+                for e in entries:
+                    counts[e["value"]] += e["weight"]
+                derived = [{"type": 0, "value": v, "weight": counts[v]} for v in ranked_values(counts)]
+                if values and values == derived:
+                    output[f"loc:{loc}"][var] = []
+                    derived_vars += 1
+
     with open(out_file, "w", encoding="utf-8") as out:
         json.dump(output, out, indent=2)
 
     # Summary
     print(f"✅ Done. Written limited-valued map to {out_file}")
     print(f"   lines: total={total_lines} good={good_lines} malformed={skipped_malformed} skipped_neg_branch={skipped_neg_branch}")
-    print(f"   entries: {len(output)}")
+    print(f"   entries: {len(output)} (context-qualified: {ctx_entries}, input-offset: {input_entries}, static vars: {static_vars}, carried vars: {carried_vars}, derived vars: {derived_vars})")
     print(f"   thresholds: MIN_OCCURRENCE={MIN_OCCURRENCE} MAX_LIMITED_VALUES={MAX_LIMITED_VALUES} branchless={'on' if keep_branchless else 'off'}")
 
 if __name__ == "__main__":
     main()
-
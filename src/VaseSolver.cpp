@@ -6,7 +6,14 @@
 #include <unordered_set>
 #include <charconv>
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cctype>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
 
 #include "klee/Solver/VaseSolver.h"
 #include "klee/Solver/SolverCmdLine.h"   // UseVaseSolver, VaseMapFile
@@ -24,6 +31,7 @@ using json = nlohmann::json;
 namespace klee {
 
 ConcreteStore VaseSolver::vaseStore;
+InputStore VaseSolver::inputStore;
 bool VaseSolver::vaseMapLoaded = false;
 std::string VaseSolver::loadedPath;
 
@@ -52,28 +60,252 @@ static llvm::cl::opt<bool> VaseTryPairSum(
   llvm::cl::init(true)
 );
 
+static llvm::cl::opt<std::string> VaseSiteStats(
+  "vase-site-stats",
+  llvm::cl::desc("Write per-site query counts, solver-time histograms and rewrite "
+                 "costs (JSON) to this file at exit; input to the pass's "
+                 "-vase-hot-sites and to tools/analyzer/prune_map.py"),
+  llvm::cl::init("")
+);
+
+static llvm::cl::opt<bool> VaseProfileOnly(
+  "vase-profile-only",
+  llvm::cl::desc("Only record --vase-site-stats, never rewrite (vanilla behaviour)"),
+  llvm::cl::init(false)
+);
+
+static llvm::cl::opt<std::string> VaseLibMap(
+  "vase-lib-map",
+  llvm::cl::desc("Shared-library map (tools/analyzer/build_lib_map.py); same as "
+                 "appending it as the last --vase-map layer"),
+  llvm::cl::init("")
+);
+
 static llvm::cl::opt<bool> VaseVerboseApplied(
   "vase-verbose",
   llvm::cl::desc("Print when a VASE rewrite is applied and what it was"),
   llvm::cl::init(true)
 );
 
+static bool parseInt64(const std::string& s, int64_t& out);
+
+// Distinct numeric values across all vars of an entry, most observed first;
+// weights of a value seen under several vars add up. Ties, and unweighted
+// values after the weighted ones, in numeric order (as the analyzer and
+// vase-mapgen rank), not in the hash order of the vars.
+static std::vector<std::string> rankedValues(const ReplacementPair &pair) {
+  std::vector<std::pair<std::string, uint64_t>> ranked;
+  std::unordered_map<std::string, size_t> index;
+  for (const auto &kv : pair.varToValues) {
+    for (const auto &vp : kv.second) {
+      if (vp.type != 0)
+        continue;
+      auto ins = index.emplace(vp.value, ranked.size());
+      if (ins.second)
+        ranked.emplace_back(vp.value, vp.weight);
+      else
+        ranked[ins.first->second].second += vp.weight;
+    }
+  }
+  std::sort(ranked.begin(), ranked.end(),
+            [](const std::pair<std::string, uint64_t> &a,
+               const std::pair<std::string, uint64_t> &b) {
+              if (a.second != b.second)
+                return a.second > b.second;
+              int64_t x, y;
+              const bool nx = parseInt64(a.first, x), ny = parseInt64(b.first, y);
+              if (nx != ny)
+                return nx; // non-numeric strings last
+              return nx ? x < y : a.first < b.first;
+            });
+  std::vector<std::string> out;
+  for (auto &r : ranked)
+    out.push_back(std::move(r.first));
+  return out;
+}
+
 // ---- Map loading -----------------------------------------------------------
 
-bool VaseSolver::loadVaseMap(const std::string &filename) {
-  if (vaseMapLoaded && filename == loadedPath)
-    return true;
+// loc:N:arr:NAME:OFF:W -> inputStore[loc:N] (array names contain no ':'),
+// unless the site already has that range (`shadowed`, by a higher map layer)
+static bool addInputBytes(InputStore &store, const std::string &key, size_t arr,
+                          const ReplacementPair &pair, bool &shadowed) {
+  const size_t a = arr + 5; // past ":arr:"
+  const size_t w = key.rfind(':');
+  const size_t o = w == std::string::npos ? w : key.rfind(':', w - 1);
+  if (o == std::string::npos || o <= a)
+    return false;
+  int64_t offset, width;
+  if (!parseInt64(key.substr(o + 1, w - o - 1), offset) ||
+      !parseInt64(key.substr(w + 1), width) || offset < 0 || width < 1 || width > 8)
+    return false;
 
-  vaseStore.clear();
-  vaseMapLoaded = false;
-  loadedPath.clear();
+  InputBytes bytes{key.substr(a, o - a), (unsigned)offset, (unsigned)width, {}};
+  for (const std::string &s : rankedValues(pair)) {
+    int64_t v;
+    if (parseInt64(s, v) &&
+        std::find(bytes.values.begin(), bytes.values.end(), v) == bytes.values.end())
+      bytes.values.push_back(v);
+  }
+  if (bytes.values.empty())
+    return false;
+  auto &ranges = store[key.substr(0, arr)];
+  shadowed = std::any_of(ranges.begin(), ranges.end(), [&](const InputBytes &r) {
+    return r.array == bytes.array && r.offset == bytes.offset && r.width == bytes.width;
+  });
+  if (!shadowed)
+    ranges.push_back(std::move(bytes));
+  return true;
+}
+
+// VASEMAP2, as written by tools/mapgen (vase-mapgen --binary-out): the JSON
+// map's entries without the JSON, length-prefixed and little-endian. VASEMAP1
+// is the same without the per-value weight.
+static const char VaseBinaryMagic[7] = {'V', 'A', 'S', 'E', 'M', 'A', 'P'};
 
-  std::ifstream file(filename);
+static bool readU32(std::istream &in, uint32_t &v) {
+  unsigned char b[4];
+  if (!in.read(reinterpret_cast<char *>(b), 4))
+    return false;
+  v = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+  return true;
+}
+
+static bool readU64(std::istream &in, uint64_t &v) {
+  uint32_t lo, hi;
+  if (!readU32(in, lo) || !readU32(in, hi))
+    return false;
+  v = lo | ((uint64_t)hi << 32);
+  return true;
+}
+
+// A length beyond the end of the file (`end`) is corruption, not a string
+static bool readStr(std::istream &in, std::streamoff end, std::string &s) {
+  uint32_t n;
+  if (!readU32(in, n))
+    return false;
+  const std::streamoff at = in.tellg();
+  if (at < 0 || n > end - at)
+    return false;
+  s.resize(n);
+  return n == 0 || (bool)in.read(&s[0], n);
+}
+
+static bool readBinaryMap(std::istream &in, std::streamoff end, bool weighted,
+                          std::vector<std::pair<std::string, ReplacementPair>> &out) {
+  uint32_t nKeys;
+  if (!readU32(in, nKeys))
+    return false;
+  for (uint32_t k = 0; k < nKeys; ++k) {
+    std::string location;
+    uint32_t nVars;
+    if (!readStr(in, end, location) || !readU32(in, nVars))
+      return false;
+    ReplacementPair pair;
+    for (uint32_t v = 0; v < nVars; ++v) {
+      std::string varName;
+      uint32_t nValues;
+      if (!readStr(in, end, varName) || !readU32(in, nValues))
+        return false;
+      std::vector<ValueProperties> props;
+      for (uint32_t i = 0; i < nValues; ++i) {
+        uint32_t type;
+        ValueProperties vp;
+        if (!readU32(in, type) || !readStr(in, end, vp.value) ||
+            (weighted && !readU64(in, vp.weight)))
+          return false;
+        vp.type = (int32_t)type;
+        props.push_back(std::move(vp));
+      }
+      pair.varToValues[varName] = std::move(props);
+    }
+    out.emplace_back(std::move(location), std::move(pair));
+  }
+  return true;
+}
+
+using MapEntries = std::vector<std::pair<std::string, ReplacementPair>>;
+
+// A loc:N var written as [] (the generators' dedup step) stands for the union
+// of its lists at the loc:N:branch:B entries of the same file: weights summed,
+// most observed first, ties in numeric order.
+static void deriveBranchless(MapEntries &entries) {
+  std::unordered_map<std::string, std::vector<const ReplacementPair *>> branches;
+  for (const auto &entry : entries) {
+    const std::string &key = entry.first;
+    const auto pos = key.find(":branch:");
+    if (key.compare(0, 4, "loc:") == 0 && pos != std::string::npos &&
+        key.find(":ctx:") == std::string::npos)
+      branches[key.substr(0, pos)].push_back(&entry.second);
+  }
+
+  for (auto &entry : entries) {
+    const std::string &key = entry.first;
+    if (key.compare(0, 4, "loc:") != 0 || key.find(':', 4) != std::string::npos)
+      continue;
+    auto it = branches.find(key);
+    if (it == branches.end())
+      continue;
+    for (auto &var : entry.second.varToValues) {
+      if (!var.second.empty())
+        continue;
+      std::vector<ValueProperties> merged;
+      std::unordered_map<std::string, size_t> index;
+      for (const ReplacementPair *b : it->second) {
+        auto v = b->varToValues.find(var.first);
+        if (v == b->varToValues.end())
+          continue;
+        for (const ValueProperties &vp : v->second) {
+          auto ins = index.emplace(vp.value, merged.size());
+          if (ins.second)
+            merged.push_back(vp);
+          else
+            merged[ins.first->second].weight += vp.weight;
+        }
+      }
+      std::stable_sort(merged.begin(), merged.end(),
+                       [](const ValueProperties &a, const ValueProperties &b) {
+                         if (a.weight != b.weight)
+                           return a.weight > b.weight;
+                         int64_t x, y;
+                         const bool xi = parseInt64(a.value, x), yi = parseInt64(b.value, y);
+                         return xi != yi ? xi : xi && x < y;
+                       });
+      var.second = std::move(merged);
+    }
+  }
+}
+
+// Reads a JSON or binary (VASEMAP1/2) map file; `binary` tells which it was.
+static bool readMapFile(const std::string &filename, MapEntries &entries,
+                        bool &binary) {
+  std::ifstream file(filename, std::ios::binary);
   if (!file.is_open()) {
     klee_warning("Failed to open VASE map: %s", filename.c_str());
     return false;
   }
 
+  char magic[sizeof(VaseBinaryMagic) + 1] = {};
+  file.read(magic, sizeof(magic));
+  binary = file.gcount() == sizeof(magic) &&
+           std::equal(VaseBinaryMagic, VaseBinaryMagic + sizeof(VaseBinaryMagic), magic) &&
+           (magic[sizeof(VaseBinaryMagic)] == '1' || magic[sizeof(VaseBinaryMagic)] == '2');
+  if (binary) {
+    const std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff end = file.tellg();
+    file.seekg(start);
+    if (!readBinaryMap(file, end, magic[sizeof(VaseBinaryMagic)] == '2', entries)) {
+      klee_warning("Truncated or corrupt binary VASE map: %s", filename.c_str());
+      entries.clear();
+      return false;
+    }
+    deriveBranchless(entries);
+    return true;
+  }
+  file.clear();
+  file.seekg(0);
+
   json j = json::parse(file, nullptr, false);
   if (j.is_discarded()) {
     klee_warning("JSON parse error in VASE map: %s", filename.c_str());
@@ -99,34 +331,221 @@ bool VaseSolver::loadVaseMap(const std::string &filename) {
         ValueProperties vp;
         vp.type  = val["type"].get<int>();
         vp.value = val["value"].get<std::string>();
+        if (val.contains("weight") && val["weight"].is_number_unsigned())
+          vp.weight = val["weight"].get<uint64_t>();
         // ops (optional) ignored for now
         props.push_back(vp);
       }
       pair.varToValues[varName] = std::move(props);
     }
 
-    vaseStore[location] = std::move(pair);
+    entries.emplace_back(location, std::move(pair));
   }
+  deriveBranchless(entries);
+  return true;
+}
+
+bool VaseSolver::loadVaseMap(const std::string &spec) {
+  if (vaseMapLoaded && spec == loadedPath)
+    return true;
+
+  vaseStore.clear();
+  inputStore.clear();
+  vaseMapLoaded = false;
+  loadedPath.clear();
+
+  // Comma-separated layers, highest priority first, merged here into the one
+  // store: a layer only adds the vars (and input byte ranges) that the layers
+  // before it do not have for a key, so lookups stay a single hash probe.
+  unsigned layers = 0;
+  std::stringstream ss(spec);
+  std::string filename;
+  while (std::getline(ss, filename, ',')) {
+    if (filename.empty())
+      continue;
+    MapEntries entries;
+    bool binary = false;
+    if (!readMapFile(filename, entries, binary))
+      continue;
+
+    // An entry is used when it adds at least one var or input byte range
+    size_t used = 0, siteless = 0;
+    for (auto &entry : entries) {
+      if (entry.first.compare(0, 4, "arr:") == 0) {
+        ++siteless;
+        continue;
+      }
+      const size_t arr = entry.first.find(":arr:");
+      if (arr != std::string::npos) {
+        bool shadowed = false;
+        if (!addInputBytes(inputStore, entry.first, arr, entry.second, shadowed))
+          klee_warning("Ignoring malformed VASE input entry %s", entry.first.c_str());
+        else
+          used += !shadowed;
+        continue;
+      }
+      auto &vars = vaseStore[entry.first].varToValues;
+      bool added = false;
+      for (auto &var : entry.second.varToValues)
+        added |= vars.emplace(var.first, std::move(var.second)).second;
+      used += added;
+    }
+    if (siteless)
+      klee_warning("VASE map '%s': ignoring %zu arr: entries without a site "
+                   "(regenerate the map)", filename.c_str(), siteless);
+    ++layers;
+    klee_message("VASE map layer %u: %s'%s', %zu of %zu entries used", layers,
+                 binary ? "binary " : "", filename.c_str(), used, entries.size());
+  }
+  if (layers == 0)
+    return false;
 
   vaseMapLoaded = true;
-  loadedPath = filename;
+  loadedPath = spec;
 
-  klee_message("Loaded VASE map '%s' with %zu entries",
-               loadedPath.c_str(), vaseStore.size());
+  klee_message("Loaded VASE map '%s' with %zu entries (input bytes at %zu sites)",
+               loadedPath.c_str(), vaseStore.size(), inputStore.size());
   return true;
 }
 
+// ---- Per-site solver statistics (--vase-site-stats) -------------------------
+
+namespace {
+// Bucket i counts queries that took [2^i, 2^(i+1)) microseconds (0 in bucket 0).
+constexpr unsigned SiteHistogramBuckets = 32;
+
+struct SiteStats {
+  uint64_t queries = 0;
+  uint64_t micros = 0;
+  uint64_t histogram[SiteHistogramBuckets] = {};
+  // What the rewrites cost and bought, for tools/analyzer/prune_map.py
+  uint64_t rewritten = 0;   // queries answered on a rewritten query
+  uint64_t trials = 0;      // candidate queries tried (all queries)
+  uint64_t trialMicros = 0; // time spent on them, included in micros
+};
+
+std::map<std::string, SiteStats> siteStats; // by loc:N (branches merged)
+
+// Rewrite trials of the query being timed by the current SiteTimer
+struct QueryCost {
+  uint64_t trials = 0;
+  uint64_t micros = 0;
+};
+QueryCost *activeQuery = nullptr;
+
+void recordSiteQuery(const std::string &location, uint64_t micros,
+                     const QueryCost &cost, bool rewritten) {
+  // Branch and calling context both qualify loc:N
+  const auto pos = location.find(':', 4);
+  SiteStats &s = siteStats[location.substr(0, pos)];
+  ++s.queries;
+  s.micros += micros;
+  s.rewritten += rewritten;
+  s.trials += cost.trials;
+  s.trialMicros += cost.micros;
+  unsigned bucket = 0;
+  while (bucket + 1 < SiteHistogramBuckets && (micros >> (bucket + 1)) != 0)
+    ++bucket;
+  ++s.histogram[bucket];
+}
+
+void writeSiteStats() {
+  std::ofstream out(VaseSiteStats.getValue());
+  if (!out.is_open()) {
+    klee_warning("Failed to write VASE site stats: %s", VaseSiteStats.c_str());
+    return;
+  }
+  json j = json::object();
+  for (const auto &kv : siteStats) {
+    const SiteStats &s = kv.second;
+    unsigned used = SiteHistogramBuckets;
+    while (used > 0 && s.histogram[used - 1] == 0)
+      --used;
+    j[kv.first] = {{"queries", s.queries},
+                   {"solver_us", s.micros},
+                   {"histogram", std::vector<uint64_t>(s.histogram, s.histogram + used)},
+                   {"rewritten", s.rewritten},
+                   {"trials", s.trials},
+                   {"trial_us", s.trialMicros}};
+  }
+  out << j.dump(2) << "\n";
+}
+
+uint64_t microsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start).count();
+}
+
+// Times one query, rewrite attempts included, against its site.
+class SiteTimer {
+  const std::string &location;
+  const bool &rewritten;
+  std::chrono::steady_clock::time_point start;
+  QueryCost cost;
+
+public:
+  SiteTimer(const std::string &location, const bool &rewritten)
+      : location(location), rewritten(rewritten),
+        start(std::chrono::steady_clock::now()) {
+    activeQuery = &cost;
+  }
+  ~SiteTimer() {
+    activeQuery = nullptr;
+    if (VaseSiteStats.empty())
+      return;
+    recordSiteQuery(location, microsSince(start), cost, rewritten);
+  }
+};
+
+// Times one candidate query of a rewrite against the active SiteTimer.
+class TrialTimer {
+  std::chrono::steady_clock::time_point start;
+
+public:
+  TrialTimer() : start(std::chrono::steady_clock::now()) {}
+  ~TrialTimer() {
+    if (!activeQuery)
+      return;
+    ++activeQuery->trials;
+    activeQuery->micros += microsSince(start);
+  }
+};
+} // namespace
+
+namespace {
+bool mapConfigured = false;
+bool statsRegistered = false;
+
+void registerSiteStats() {
+  if (!VaseSiteStats.empty() && !statsRegistered) {
+    std::atexit(writeSiteStats);
+    statsRegistered = true;
+  }
+}
+} // namespace
+
 bool VaseSolver::ensureMapLoadedOnce() {
-  static bool loaded = false;
-  if (loaded) return true;
-  const std::string path = VaseMapFile.getValue();
-  if (path.empty()) {
-    klee_warning("VASE map not set (--vase-map), VASE rewrites disabled.");
-    loaded = true;
+  if (mapConfigured) return vaseMapLoaded;
+  registerSiteStats();
+  // --vase-lib-map alone is a map of its own: the program has no entries
+  const std::string path = VaseMapFile.empty() ? VaseLibMap.getValue()
+                           : VaseLibMap.empty() ? VaseMapFile.getValue()
+                                                : VaseMapFile + "," + VaseLibMap;
+  if (path.empty() || VaseProfileOnly) {
+    if (!VaseProfileOnly)
+      klee_warning("VASE map not set (--vase-map), VASE rewrites disabled.");
+    mapConfigured = true;
+    return false;
+  }
+  // Once, loaded or not: a map that failed to load would fail again on
+  // every query
+  mapConfigured = true;
+  if (!loadVaseMap(path)) {
+    klee_warning("VASE map '%s' could not be loaded, VASE rewrites disabled.",
+                 path.c_str());
     return false;
   }
-  loaded = loadVaseMap(path);
-  return loaded;
+  return true;
 }
 
 // ---- Location extraction ---------------------------------------------------
@@ -136,15 +555,40 @@ static llvm::Optional<std::string> scanForLocTag(const ref<Expr> &e) {
   llvm::raw_string_ostream os(s);
   e->print(os);
   os.flush();
-  // Matches loc:<N> or loc:<N>:branch:<B>
-  std::regex locRegex("loc:(\\d+)(:branch:(\\d+))?");
+  // Matches loc:<N>, optionally followed by :branch:<B> and by the
+  // :ctx:<H> calling-context hash of the logger runtime (VASE_CTX_DEPTH)
+  static const std::regex locRegex(
+      "loc:(\\d+)(:branch:(\\d+))?(:ctx:([0-9a-fA-F]+))?");
   std::smatch m;
-  if (std::regex_search(s, m, locRegex)) {
-    if (m[3].matched)
-      return std::string("loc:") + m[1].str() + ":branch:" + m[3].str();
-    return std::string("loc:") + m[1].str();
+  if (!std::regex_search(s, m, locRegex))
+    return llvm::None;
+  std::string tag = "loc:" + m[1].str();
+  if (m[3].matched)
+    tag += ":branch:" + m[3].str();
+  if (m[5].matched) {
+    std::string hash = m[5].str();
+    std::transform(hash.begin(), hash.end(), hash.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    tag += ":ctx:" + hash;
   }
-  return llvm::None;
+  return tag;
+}
+
+// Map keys for a location tag, most specific first
+static std::vector<std::string> lookupKeys(const std::string &location) {
+  const auto ctx = location.find(":ctx:");
+  const std::string site = location.substr(0, ctx);
+  const auto branch = site.find(":branch:");
+  std::vector<std::string> keys;
+  if (ctx != std::string::npos) {
+    keys.push_back(location);
+    if (branch != std::string::npos)
+      keys.push_back(site.substr(0, branch) + location.substr(ctx));
+  }
+  keys.push_back(site);
+  if (branch != std::string::npos)
+    keys.push_back(site.substr(0, branch));
+  return keys;
 }
 
 std::string VaseSolver::extractLocationFromQuery(const Query &query) {
@@ -204,6 +648,25 @@ static unsigned inferBytesUsed(const Query& q, const Array* arr) {
   return bytes;
 }
 
+// Constant indices at which the query reads `arr`.
+static std::unordered_set<uint64_t> readIndices(const Query& q, const Array* arr) {
+  struct IxCollector : public ExprVisitor {
+    const Array* target;
+    std::unordered_set<uint64_t> indices;
+    IxCollector(const Array* a) : target(a) {}
+    Action visitRead(const ReadExpr &re) override {
+      if (re.updates.root == target)
+        if (auto *ci = dyn_cast<ConstantExpr>(re.index))
+          indices.insert(ci->getZExtValue());
+      return Action::doChildren();
+    }
+  } F(arr);
+
+  for (auto &c : q.constraints) F.visit(c);
+  F.visit(q.expr);
+  return F.indices;
+}
+
 static ref<Expr> packUInt32LE(const Array* arr, unsigned nBytes) {
   if (nBytes == 0) nBytes = 4;
   if (nBytes > 4) nBytes = 4;
@@ -225,42 +688,102 @@ static bool parseInt64(const std::string& s, int64_t& out) {
 
 // ---- Rewriter core ---------------------------------------------------------
 
+// The map says exactly which bytes of which array the site read, so there is
+// nothing to guess: pin the read range to each profiled value in turn. Like
+// the site rewrite, at most VaseMaxArrays arrays of the query are tried.
+Query VaseSolver::rewriteWithInputBytes(const Query &original,
+                                        const std::string &location,
+                                        bool &changed) {
+  changed = false;
+  auto site = inputStore.find(location.substr(0, location.find(':', 4)));
+  if (site == inputStore.end())
+    return original;
+  const ConstraintSet &baseC = original.constraints;
+  const ref<Expr>     &baseE = original.expr;
+
+  auto trySolve = [&](const ConstraintSet &cs) -> bool {
+    TrialTimer trial;
+    Query q(cs, baseE);
+    Solver::Validity v;
+    if (!underlying->computeValidity(q, v))
+      return false;
+    return v != Solver::False;
+  };
+
+  unsigned arrays = 0;
+  for (const Array* a : findAllArraysInQuery(original)) {
+    const auto read = readIndices(original, a);
+    bool counted = false;
+    for (const InputBytes &in : site->second) {
+      if (in.array != a->name || in.offset + in.width > a->size)
+        continue;
+      bool touched = false;
+      for (unsigned i = 0; i < in.width && !touched; ++i)
+        touched = read.count(in.offset + i) != 0;
+      if (!touched)
+        continue;
+      if (!counted) {
+        if (arrays == VaseMaxArrays)
+          return original;
+        ++arrays;
+        counted = true;
+      }
+
+      const size_t n = std::min<size_t>(in.values.size(), VaseMaxValuesPerSite);
+      for (size_t k = 0; k < n; ++k) {
+        ConstraintSet cs = baseC;
+        for (unsigned i = 0; i < in.width; ++i) {
+          uint64_t byte = (static_cast<uint64_t>(in.values[k]) >> (8 * i)) & 0xffULL;
+          ref<Expr> idx  = ConstantExpr::alloc(in.offset + i, Expr::Int32);
+          ref<Expr> rd   = ReadExpr::create(UpdateList(a, 0), idx);
+          cs.push_back(EqExpr::create(rd, ConstantExpr::alloc(byte, Expr::Int8)));
+        }
+        if (trySolve(cs)) {
+          changed = true;
+          if (VaseVerboseApplied)
+            klee_message("VASE applied: %s:arr:%s:%u:%u == %lld (input-bytes-eq)",
+                         site->first.c_str(), a->name.c_str(), in.offset, in.width,
+                         (long long)in.values[k]);
+          return Query(cs, baseE);
+        }
+      }
+    }
+  }
+  return original;
+}
+
 Query VaseSolver::rewriteWithVase(const Query &original,
                                   const std::string &location,
                                   bool &changed) {
-  // Try exact key, then base (branchless) fallback
-  auto iter = vaseStore.find(location);
-  if (iter == vaseStore.end()) {
-    const auto pos = location.find(":branch:");
-    if (pos != std::string::npos) {
-      std::string base = location.substr(0, pos);
-      iter = vaseStore.find(base);
-    }
+  // Input-offset entries name their bytes exactly; try them first.
+  if (!inputStore.empty()) {
+    Query q = rewriteWithInputBytes(original, location, changed);
+    if (changed)
+      return q;
+  }
+
+  // Most specific key first: loc:N:branch:B:ctx:H, loc:N:ctx:H,
+  // loc:N:branch:B, then loc:N. Generators write a ctx key only where the
+  // context narrows the merged entry, so most lookups fall through.
+  auto iter = vaseStore.end();
+  for (const std::string &key : lookupKeys(location)) {
+    iter = vaseStore.find(key);
+    if (iter != vaseStore.end())
+      break;
   }
   if (iter == vaseStore.end()) {
     changed = false;
     return original;
   }
 
-  // Collect all distinct numeric limited values at this site (ignore var names)
-  std::vector<std::string> valuesStr;
-  {
-    std::unordered_set<std::string> uniq;
-    for (const auto &kv : iter->second.varToValues) {
-      for (const auto &vp : kv.second) {
-        if (vp.type == 0 && uniq.insert(vp.value).second) {
-          valuesStr.push_back(vp.value);
-          if (valuesStr.size() >= VaseMaxValuesPerSite)
-            break;
-        }
-      }
-      if (valuesStr.size() >= VaseMaxValuesPerSite)
-        break;
-    }
-    if (valuesStr.empty()) {
-      changed = false;
-      return original;
-    }
+  // The site's distinct numeric limited values (ignore var names), likeliest
+  // first, so the first trial is the one most likely to be satisfiable
+  std::vector<std::string> valuesStr = rankedValues(iter->second);
+  if (valuesStr.size() > VaseMaxValuesPerSite)
+    valuesStr.resize(VaseMaxValuesPerSite);
+  if (valuesStr.empty()) {
+    changed = false;
+    return original;
   }
 
   // Arrays in the query
@@ -277,6 +800,7 @@ Query VaseSolver::rewriteWithVase(const Query &original,
 
   // Helper: try a candidate constraint set and accept if not UNSAT
   auto trySolve = [&](const ConstraintSet &cs) -> bool {
+    TrialTimer trial;
     Query q(cs, baseE);
     Solver::Validity v;
     if (!underlying->computeValidity(q, v))
@@ -374,27 +898,40 @@ Query VaseSolver::rewriteWithVase(const Query &original,
 
 // ---- SolverImpl plumbing ---------------------------------------------------
 
+// Per-query setup; false when the query goes to the underlying solver as is,
+// without looking up its location (nothing to rewrite or record).
+static bool prepareQuery() {
+  (void)VaseSolver::ensureMapLoadedOnce();
+  return !(VaseProfileOnly && VaseSiteStats.empty());
+}
+
 bool VaseSolver::computeValidity(const Query &query, Solver::Validity &result) {
-  (void)ensureMapLoadedOnce();
+  if (!prepareQuery())
+    return underlying->computeValidity(query, result);
   bool changed = false;
   std::string location = extractLocationFromQuery(query);
-  Query rewritten = rewriteWithVase(query, location, changed);
+  SiteTimer timer(location, changed);
+  Query rewritten = VaseProfileOnly ? query : rewriteWithVase(query, location, changed);
   return underlying->computeValidity(changed ? rewritten : query, result);
 }
 
 bool VaseSolver::computeTruth(const Query &query, bool &isValid) {
-  (void)ensureMapLoadedOnce();
+  if (!prepareQuery())
+    return underlying->computeTruth(query, isValid);
   bool changed = false;
   std::string location = extractLocationFromQuery(query);
-  Query rewritten = rewriteWithVase(query, location, changed);
+  SiteTimer timer(location, changed);
+  Query rewritten = VaseProfileOnly ? query : rewriteWithVase(query, location, changed);
   return underlying->computeTruth(changed ? rewritten : query, isValid);
 }
 
 bool VaseSolver::computeValue(const Query &query, ref<Expr> &result) {
-  (void)ensureMapLoadedOnce();
+  if (!prepareQuery())
+    return underlying->computeValue(query, result);
   bool changed = false;
   std::string location = extractLocationFromQuery(query);
-  Query rewritten = rewriteWithVase(query, location, changed);
+  SiteTimer timer(location, changed);
+  Query rewritten = VaseProfileOnly ? query : rewriteWithVase(query, location, changed);
   return underlying->computeValue(changed ? rewritten : query, result);
 }
 
@@ -402,10 +939,12 @@ bool VaseSolver::computeInitialValues(const Query &query,
                                       const std::vector<const Array *> &objects,
                                       std::vector<std::vector<unsigned char>> &values,
                                       bool &hasSolution) {
-  (void)ensureMapLoadedOnce();
+  if (!prepareQuery())
+    return underlying->computeInitialValues(query, objects, values, hasSolution);
   bool changed = false;
   std::string location = extractLocationFromQuery(query);
-  Query rewritten = rewriteWithVase(query, location, changed);
+  SiteTimer timer(location, changed);
+  Query rewritten = VaseProfileOnly ? query : rewriteWithVase(query, location, changed);
   return underlying->computeInitialValues(changed ? rewritten : query,
                                           objects, values, hasSolution);
 }
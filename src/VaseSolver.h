@@ -10,6 +10,7 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <cstdint>
 #include <nlohmann/json.hpp>
 
 namespace klee {
@@ -20,6 +21,7 @@ class Array;
 struct ValueProperties {
   int type;                // e.g., numeric vs string marker used by your analyzer
   std::string value;       // serialized value (stringified number or literal)
+  uint64_t weight = 0;     // times observed while profiling (0 = unknown)
   std::vector<std::string> ops; // optional: operators/context info from logger/analyzer
 };
 
@@ -31,11 +33,24 @@ struct ReplacementPair {
 // location key -> ReplacementPair
 using ConcreteStore = std::unordered_map<std::string, ReplacementPair>;
 
+// Profiled values of input bytes [offset, offset + width) of one KLEE array,
+// from loc:N:arr:NAME:OFF:W map entries (-vase-input-offsets).
+struct InputBytes {
+  std::string array; // arg00, stdin, A-data, ...
+  unsigned offset;
+  unsigned width;
+  std::vector<int64_t> values; // little-endian, width bytes
+};
+
+// loc:N -> the input byte ranges its operands were loaded from
+using InputStore = std::unordered_map<std::string, std::vector<InputBytes>>;
+
 class VaseSolver : public SolverImpl {
   SolverImpl *underlying;
 
   // Shared map across the process; loaded once from JSON
   static ConcreteStore vaseStore;
+  static InputStore inputStore;
   static bool vaseMapLoaded;
   static std::string loadedPath;
 
@@ -48,12 +63,17 @@ public:
     (void)ensureMapLoadedOnce(); // self-contained: load map on construction
   }
 
-  /// Load/replace the VASE map from a JSON file
-  static bool loadVaseMap(const std::string &filename);
+  /// Load/replace the VASE map from a comma-separated list of JSON or binary
+  /// map files, highest priority first (program, library, static, ...)
+  static bool loadVaseMap(const std::string &spec);
 
   /// Attempt to rewrite a query using map entries for `location`
   Query rewriteWithVase(const Query &original, const std::string &location, bool &changed);
 
+  /// Constrain input bytes the map has loc:N:arr: entries for at `location`
+  Query rewriteWithInputBytes(const Query &original, const std::string &location,
+                              bool &changed);
+
   /// Extract `loc:*` (and optionally branch) from a query's constraint log
   static std::string extractLocationFromQuery(const Query &query);
 